@@ -0,0 +1,94 @@
+/*
+ * barrier_bench.c
+ *
+ * Microbenchmark: cost of one barrier phase with 2/4/8 threads, for
+ *   - Barrier with the spin phase (BARRIER_DEFAULT_SPIN)
+ *   - Barrier without spinning (straight to the futex)
+ *   - a hand-built Mutex + CondVar barrier with a generation counter
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "adv_thread.h"
+#include "adv_mutex.h"
+#include "adv_semaphore.h"
+#include "adv_futex.h"
+
+#define PHASES      20000L
+#define MAX_THREADS 8
+
+typedef enum { KIND_SPIN, KIND_FUTEX, KIND_CONDVAR } BarrierKind;
+
+typedef struct {
+    BarrierKind kind;
+    Barrier     barrier;
+    Mutex       mutex;
+    CondVar     cond;
+    int         arrived;
+    int         nthreads;
+    long        generation;
+} BenchState;
+
+static void condvar_barrier_wait(BenchState* st) {
+    Mutex_lock(&st->mutex);
+    long gen = st->generation;
+    if (++st->arrived == st->nthreads) {
+        st->arrived = 0;
+        st->generation++;
+        CondVar_broadcast(&st->cond);
+    } else {
+        while (gen == st->generation) {
+            CondVar_wait(&st->cond, &st->mutex);
+        }
+    }
+    Mutex_unlock(&st->mutex);
+}
+
+static void* phase_worker(void* arg) {
+    BenchState* st = (BenchState*)arg;
+    long i;
+    for (i = 0; i < PHASES; i++) {
+        if (st->kind == KIND_CONDVAR) condvar_barrier_wait(st);
+        else                          Barrier_wait(&st->barrier);
+    }
+    return NULL;
+}
+
+static void bench_phases(BarrierKind kind, int nthreads) {
+    static const char* names[] = { "Barrier (spin)", "Barrier (futex)", "Mutex+CondVar" };
+    BenchState st;
+    AdvThread threads[MAX_THREADS];
+    int i;
+    st.kind = kind;
+    st.nthreads = nthreads;
+    st.arrived = 0;
+    st.generation = 0;
+    Barrier_init(&st.barrier, (unsigned int)nthreads, kind == KIND_SPIN ? BARRIER_DEFAULT_SPIN : 0);
+    Mutex_init(&st.mutex, 0);
+    CondVar_init(&st.cond);
+
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < nthreads; i++) {
+        thread_create(&threads[i], phase_worker, &st);
+    }
+    for (i = 0; i < nthreads; i++) {
+        thread_join(&threads[i]);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  %-16s %d thr : %8.0f ns/phase\n", names[kind], nthreads, (double)dt / (double)PHASES);
+
+    CondVar_destroy(&st.cond);
+    Mutex_destroy(&st.mutex);
+    Barrier_destroy(&st.barrier);
+}
+
+int main(void) {
+    int n;
+    printf("=== barrier_bench ===\n");
+    for (n = 2; n <= MAX_THREADS; n *= 2) {
+        bench_phases(KIND_SPIN, n);
+        bench_phases(KIND_FUTEX, n);
+        bench_phases(KIND_CONDVAR, n);
+    }
+    return 0;
+}
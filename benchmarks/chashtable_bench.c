@@ -0,0 +1,122 @@
+/*
+ * chashtable_bench.c
+ *
+ * Microbenchmark: read-mostly throughput of ConcurrentHashTable against a
+ * HashTable behind one global RWLock, with 1..64 threads. Each operation
+ * is a lookup of a random existing key, and every WRITE_EVERY-th one an
+ * insert_or_assign of a random key instead (95% reads by default).
+ * Scaling beyond the number of cores says nothing, so compare the columns
+ * up to 'nproc'.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "containers.h"
+#include "adv_thread.h"
+#include "adv_mutex.h"
+#include "adv_futex.h"
+
+#define NUM_KEYS       200000L
+#define OPS_PER_THREAD 100000L
+#define WRITE_EVERY    20L
+#define MAX_THREADS    64
+
+typedef struct {
+    bool                 sharded;
+    ConcurrentHashTable* cht;
+    HashTable*           ht;      /* global-lock variant */
+    RWLock               rw;
+    char               (*keys)[32];
+    volatile long        sink;
+} BenchState;
+
+typedef struct {
+    BenchState*        st;
+    unsigned long long rng;
+} Worker;
+
+static unsigned long long next_rand(unsigned long long* s) {
+    /* xorshift64 */
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void* worker(void* arg) {
+    Worker* w = (Worker*)arg;
+    BenchState* st = w->st;
+    long i, hits = 0;
+    for (i = 0; i < OPS_PER_THREAD; i++) {
+        const char* key = st->keys[next_rand(&w->rng) % (unsigned long long)NUM_KEYS];
+        if (i % WRITE_EVERY == 0) {
+            if (st->sharded) {
+                cht_insert_or_assign(st->cht, key, (void*)key);
+            } else {
+                RWLock_write_lock(&st->rw);
+                ht_insert(st->ht, key, (void*)key);
+                RWLock_write_unlock(&st->rw);
+            }
+        } else if (st->sharded) {
+            hits += cht_get(st->cht, key) != NULL;
+        } else {
+            RWLock_read_lock(&st->rw);
+            hits += ht_get(st->ht, key) != NULL;
+            RWLock_read_unlock(&st->rw);
+        }
+    }
+    st->sink += hits;
+    return NULL;
+}
+
+static double bench(BenchState* st, int nthreads) {
+    AdvThread threads[MAX_THREADS];
+    Worker workers[MAX_THREADS];
+    int i;
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < nthreads; i++) {
+        workers[i].st = st;
+        workers[i].rng = 0x9E3779B97F4A7C15ULL * (unsigned long long)(i + 1);
+        thread_create(&threads[i], worker, &workers[i]);
+    }
+    for (i = 0; i < nthreads; i++) {
+        thread_join(&threads[i]);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    return (double)OPS_PER_THREAD * nthreads * 1000.0 / (double)dt;
+}
+
+int main(void) {
+    BenchState st;
+    long i;
+    int n;
+    st.keys = (char (*)[32])malloc((size_t)NUM_KEYS * sizeof(*st.keys));
+    for (i = 0; i < NUM_KEYS; i++) {
+        snprintf(st.keys[i], sizeof(st.keys[i]), "user:%ld", i * 7919L);
+    }
+    st.cht = cht_create((size_t)NUM_KEYS * 2, 0);
+    st.ht = ht_create((size_t)NUM_KEYS * 2);
+    RWLock_init(&st.rw, MUTEX_DEFAULT_SPIN);
+    for (i = 0; i < NUM_KEYS; i++) {
+        cht_insert_or_assign(st.cht, st.keys[i], st.keys[i]);
+        ht_insert(st.ht, st.keys[i], st.keys[i]);
+    }
+    st.sink = 0;
+
+    printf("=== chashtable_bench (%ld keys, %ld%% reads) ===\n",
+           NUM_KEYS, 100 - 100 / WRITE_EVERY);
+    printf("  threads   global RWLock   ConcurrentHashTable   (Mops/s)\n");
+    for (n = 1; n <= MAX_THREADS; n *= 2) {
+        st.sharded = false;
+        double global = bench(&st, n);
+        st.sharded = true;
+        double sharded = bench(&st, n);
+        printf("  %7d   %13.2f   %19.2f\n", n, global, sharded);
+    }
+
+    cht_destroy(st.cht);
+    ht_destroy(st.ht);
+    RWLock_destroy(&st.rw);
+    free(st.keys);
+    return 0;
+}
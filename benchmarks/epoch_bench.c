@@ -0,0 +1,123 @@
+/*
+ * epoch_bench.c
+ *
+ * Microbenchmark: read-side cost of EpochDomain vs. RWLock, with 1/2/4/8
+ * reader threads looking up a shared node while one writer replaces it
+ * every WRITE_EVERY reads (of the first reader).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "adv_thread.h"
+#include "adv_mutex.h"
+#include "adv_epoch.h"
+#include "adv_atomic.h"
+#include "adv_futex.h"
+
+#define READS_PER_THREAD 2000000L
+#define WRITE_EVERY      1000L
+#define MAX_THREADS      8
+
+typedef struct {
+    long value;
+} Node;
+
+typedef struct {
+    bool           use_epoch;
+    EpochDomain*   domain;
+    RWLock         rw;
+    void* volatile current;   /* Node* */
+    volatile long  sink;
+} BenchState;
+
+static void replace_node(BenchState* st, long value) {
+    Node* n = (Node*)malloc(sizeof(Node));
+    n->value = value;
+    if (st->use_epoch) {
+        Node* old = (Node*)adv_atomic_exchange_ptr(&st->current, n, ADV_ACQ_REL);
+        EpochDomain_retire(st->domain, old, free);
+    } else {
+        RWLock_write_lock(&st->rw);
+        Node* old = (Node*)st->current;
+        st->current = n;
+        RWLock_write_unlock(&st->rw);
+        free(old);
+    }
+}
+
+static void* reader(void* arg) {
+    BenchState* st = (BenchState*)arg;
+    long i, sum = 0;
+    for (i = 0; i < READS_PER_THREAD; i++) {
+        if (st->use_epoch) {
+            EpochDomain_enter(st->domain);
+            sum += ((Node*)adv_atomic_load_ptr(&st->current, ADV_ACQUIRE))->value;
+            EpochDomain_exit(st->domain);
+        } else {
+            RWLock_read_lock(&st->rw);
+            sum += ((Node*)st->current)->value;
+            RWLock_read_unlock(&st->rw);
+        }
+    }
+    st->sink += sum;
+    return NULL;
+}
+
+/* the first reader also plays writer */
+static void* reader_writer(void* arg) {
+    BenchState* st = (BenchState*)arg;
+    long i, sum = 0;
+    for (i = 0; i < READS_PER_THREAD; i++) {
+        if (i % WRITE_EVERY == 0) replace_node(st, i);
+        if (st->use_epoch) {
+            EpochDomain_enter(st->domain);
+            sum += ((Node*)adv_atomic_load_ptr(&st->current, ADV_ACQUIRE))->value;
+            EpochDomain_exit(st->domain);
+        } else {
+            RWLock_read_lock(&st->rw);
+            sum += ((Node*)st->current)->value;
+            RWLock_read_unlock(&st->rw);
+        }
+    }
+    st->sink += sum;
+    return NULL;
+}
+
+static void bench_reads(bool use_epoch, int nthreads) {
+    BenchState st;
+    AdvThread threads[MAX_THREADS];
+    int i;
+    st.use_epoch = use_epoch;
+    st.domain = EpochDomain_create(0);
+    RWLock_init(&st.rw, MUTEX_DEFAULT_SPIN);
+    st.current = calloc(1, sizeof(Node));
+    st.sink = 0;
+
+    long long t0 = adv_monotonic_ns();
+    thread_create(&threads[0], reader_writer, &st);
+    for (i = 1; i < nthreads; i++) {
+        thread_create(&threads[i], reader, &st);
+    }
+    for (i = 0; i < nthreads; i++) {
+        thread_join(&threads[i]);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    double total = (double)READS_PER_THREAD * nthreads;
+    printf("  %-12s %d thr : %6.2f ns/read, %7.1f Mreads/s\n",
+           use_epoch ? "EpochDomain" : "RWLock", nthreads,
+           (double)dt / total, total * 1000.0 / (double)dt);
+
+    EpochDomain_destroy(st.domain);
+    RWLock_destroy(&st.rw);
+    free((void*)st.current);
+}
+
+int main(void) {
+    int n;
+    printf("=== epoch_bench ===\n");
+    for (n = 1; n <= MAX_THREADS; n *= 2) {
+        bench_reads(false, n);
+        bench_reads(true, n);
+    }
+    return 0;
+}
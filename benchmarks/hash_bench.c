@@ -0,0 +1,65 @@
+/*
+ * hash_bench.c
+ *
+ * Microbenchmark: hashing throughput of ht_hash against the byte-at-a-time
+ * djb2 HashTable used before, for key lengths from 4 bytes to 4 KiB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "containers.h"
+#include "adv_futex.h"
+
+#define TOTAL_BYTES (256L * 1024 * 1024)
+#define BUF_SIZE    (64 * 1024)
+
+static unsigned long djb2(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned long h = 5381;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h = ((h << 5) + h) + p[i];
+    }
+    return h;
+}
+
+static void bench_len(const unsigned char* buf, size_t len) {
+    long iters = TOTAL_BYTES / (long)(len + 8);
+    size_t span = BUF_SIZE - len;
+    unsigned long long sink = 0;
+    long i;
+
+    /* the key moves through the buffer so every hash sees different bytes */
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < iters; i++) {
+        sink += djb2(buf + (size_t)i % span, len);
+    }
+    long long t_djb2 = adv_monotonic_ns() - t0;
+
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < iters; i++) {
+        sink += ht_hash(buf + (size_t)i % span, len, sink);
+    }
+    long long t_wy = adv_monotonic_ns() - t0;
+
+    printf("  %5zu bytes : djb2 %7.2f ns %6.2f GB/s | ht_hash %7.2f ns %6.2f GB/s  (%llu)\n", len,
+           (double)t_djb2 / (double)iters, (double)iters * (double)len / (double)t_djb2,
+           (double)t_wy / (double)iters, (double)iters * (double)len / (double)t_wy,
+           sink & 1);
+}
+
+int main(void) {
+    static const size_t lengths[] = { 4, 8, 12, 16, 24, 32, 64, 128, 256, 1024, 4096 };
+    unsigned char* buf = (unsigned char*)malloc(BUF_SIZE);
+    size_t i;
+    for (i = 0; i < BUF_SIZE; i++) {
+        buf[i] = (unsigned char)(rand() & 0xFF);
+    }
+    printf("=== hash_bench ===\n");
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench_len(buf, lengths[i]);
+    }
+    free(buf);
+    return 0;
+}
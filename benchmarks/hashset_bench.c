@@ -0,0 +1,159 @@
+/*
+ * hashset_bench.c
+ *
+ * Microbenchmark: HashSet with linear probing against Robin Hood probing.
+ * Keeps LIVE elements in the set while sliding the live window over
+ * CHURN further keys (one remove + one insert per step), then measures
+ * hits, misses, tombstones, memory and the probe-length histogram.
+ * Then times intersecting and uniting two ALGEBRA-element sets by hand
+ * (hs_iterate + hs_contains / hs_insert) against hs_intersect / hs_union /
+ * hs_is_subset, sequential and on a ThreadPool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "containers.h"
+#include "adv_futex.h"
+
+#define LIVE    200000L
+#define CHURN   2000000L
+#define LOOKUPS 200000L
+#define ALGEBRA 1000000L
+#define WORKERS 4
+
+static unsigned long long g_rng = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long next_rand(void) {
+    /* xorshift64 */
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static size_t u64_hash(const void* p) {
+    uint64_t x = *(const uint64_t*)p;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+static bool u64_eq(const void* a, const void* b) {
+    return *(const uint64_t*)a == *(const uint64_t*)b;
+}
+
+static void run(HSProbing probing, const uint64_t* keys, const uint64_t* absent) {
+    HashSet* hs = hs_create_ex(16, u64_hash, u64_eq, probing, 0.0f);
+    long i;
+    size_t found = 0;
+    printf("[%s]\n", probing == HS_ROBIN_HOOD ? "Robin Hood" : "linear probing");
+
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < LIVE; i++) hs_insert(hs, (void*)&keys[i]);
+    for (i = 0; i < CHURN; i++) {
+        hs_remove(hs, &keys[i]);
+        hs_insert(hs, (void*)&keys[i + LIVE]);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  %-22s: %7.1f ns/op\n", "insert + churn", (double)dt / (double)(LIVE + 2 * CHURN));
+
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < LOOKUPS; i++) found += hs_contains(hs, &keys[CHURN + i % LIVE]);
+    printf("  %-22s: %7.1f ns/op\n", "contains (hit)", (double)(adv_monotonic_ns() - t0) / (double)LOOKUPS);
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < LOOKUPS; i++) found += hs_contains(hs, &absent[i]);
+    printf("  %-22s: %7.1f ns/op\n", "contains (miss)", (double)(adv_monotonic_ns() - t0) / (double)LOOKUPS);
+
+    HSStats st;
+    hs_stats(hs, &st);
+    printf("  size %zu, capacity %zu, tombstones %zu, avg probe %.2f, max probe %zu (found %zu)\n",
+           st.size, st.capacity, st.tombstones, st.avg_probe, st.max_probe, found);
+    printf("  memory %.2f MB (%.1f bytes/slot)\n", st.memory_bytes / (1024.0 * 1024.0),
+           (double)st.memory_bytes / (double)st.capacity);
+    printf("  probe histogram:");
+    for (i = 0; i < HS_PROBE_HIST_BUCKETS; i++) {
+        if (st.probe_hist[i]) {
+            printf(" %s%ld:%zu", i == HS_PROBE_HIST_BUCKETS - 1 ? ">=" : "", i + 1, st.probe_hist[i]);
+        }
+    }
+    printf("\n");
+    hs_destroy(hs);
+}
+
+typedef struct {
+    const HashSet* other;
+    HashSet*       out;
+} ManualCtx;
+
+static void manual_intersect(void* elem, void* userData) {
+    ManualCtx* c = (ManualCtx*)userData;
+    if (hs_contains(c->other, elem)) hs_insert(c->out, elem);
+}
+
+static void manual_insert(void* elem, void* userData) {
+    hs_insert((HashSet*)userData, elem);
+}
+
+static void run_algebra(const uint64_t* keys) {
+    HashSet* a = hs_create(16, u64_hash, u64_eq);
+    HashSet* b = hs_create(16, u64_hash, u64_eq);
+    ThreadPool* pool = thread_pool_create(WORKERS);
+    long i;
+    /* half of each set overlaps the other */
+    for (i = 0; i < ALGEBRA; i++) {
+        hs_insert(a, (void*)&keys[i]);
+        hs_insert(b, (void*)&keys[i + ALGEBRA / 2]);
+    }
+    printf("[set algebra, 2 x %ld elements]\n", ALGEBRA);
+
+    long long t0 = adv_monotonic_ns();
+    ManualCtx c = { b, hs_create(16, u64_hash, u64_eq) };
+    hs_iterate(a, manual_intersect, &c);
+    printf("  %-30s: %8.2f ms\n", "intersect by hand", (adv_monotonic_ns() - t0) / 1e6);
+    hs_destroy(c.out);
+    t0 = adv_monotonic_ns();
+    HashSet* u = hs_create(16, u64_hash, u64_eq);
+    hs_iterate(a, manual_insert, u);
+    hs_iterate(b, manual_insert, u);
+    printf("  %-30s: %8.2f ms\n", "union by hand", (adv_monotonic_ns() - t0) / 1e6);
+    hs_destroy(u);
+
+    int par;
+    for (par = 0; par < 2; par++) {
+        ThreadPool* p = par ? pool : NULL;
+        t0 = adv_monotonic_ns();
+        HashSet* r = hs_intersect(a, b, p);
+        printf("  %-30s: %8.2f ms\n", par ? "hs_intersect (pool)" : "hs_intersect",
+               (adv_monotonic_ns() - t0) / 1e6);
+        hs_destroy(r);
+        t0 = adv_monotonic_ns();
+        r = hs_union(a, b, p);
+        printf("  %-30s: %8.2f ms\n", par ? "hs_union (pool)" : "hs_union",
+               (adv_monotonic_ns() - t0) / 1e6);
+        hs_destroy(r);
+        t0 = adv_monotonic_ns();
+        bool sub = hs_is_subset(a, b, p);
+        printf("  %-30s: %8.2f ms (%d)\n", par ? "hs_is_subset (pool)" : "hs_is_subset",
+               (adv_monotonic_ns() - t0) / 1e6, (int)sub);
+    }
+    thread_pool_destroy(pool);
+    hs_destroy(a);
+    hs_destroy(b);
+}
+
+int main(void) {
+    uint64_t* keys = (uint64_t*)malloc((size_t)(LIVE + CHURN) * sizeof(uint64_t));
+    uint64_t* absent = (uint64_t*)malloc((size_t)LOOKUPS * sizeof(uint64_t));
+    long i;
+    for (i = 0; i < LIVE + CHURN; i++) keys[i] = next_rand() | 1;  /* odd: inserted */
+    for (i = 0; i < LOOKUPS; i++) absent[i] = next_rand() & ~1ULL; /* even: never */
+    printf("=== hashset_bench (%ld live, %ld churn steps) ===\n", LIVE, CHURN);
+    run(HS_LINEAR_PROBING, keys, absent);
+    run(HS_ROBIN_HOOD, keys, absent);
+    run_algebra(keys);
+    free(keys);
+    free(absent);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * hashtable_bench.c
+ *
+ * Microbenchmark for HashTable:
+ *   - growth: N inserts into a table created with 16 slots, reporting the
+ *     average and the worst single-insert latency plus probe statistics
+ *   - lookups of every key (hits) and of as many absent keys (misses),
+ *     one by one and through ht_get_batch
+ *   - the same table built with one ht_insert_bulk call
+ *   - churn: a steady live set under random remove + insert, reporting
+ *     throughput, capacity and memory per round (they must stay flat)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "containers.h"
+#include "adv_futex.h"
+
+#define NUM_KEYS 1000000L
+#define LOOKUP_BATCH 64
+
+#define CHURN_LIVE   100000L
+#define CHURN_ROUNDS 8
+#define CHURN_OPS    200000L
+
+static char (*make_keys(long n, const char* prefix))[32] {
+    char (*keys)[32] = (char (*)[32])malloc((size_t)n * sizeof(*keys));
+    long i;
+    for (i = 0; i < n; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "%s:%ld", prefix, i * 7919L);
+    }
+    return keys;
+}
+
+static void print_stats(const char* when, const HashTable* ht) {
+    HTStats st;
+    ht_stats(ht, &st);
+    printf("  %-14s: count %zu, capacity %zu, load %.2f, avg probe %.2f, max probe %zu%s\n",
+           when, st.count, st.capacity, st.load_factor, st.avg_probe, st.max_probe,
+           st.rehashing ? " (rehashing)" : "");
+}
+
+static void bench_growth_and_lookup(void) {
+    char (*keys)[32] = make_keys(NUM_KEYS, "user");
+    char (*absent)[32] = make_keys(NUM_KEYS, "none");
+    HashTable* ht = ht_create(16);
+    long long worst = 0;
+    long i;
+
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) {
+        long long s = adv_monotonic_ns();
+        ht_insert(ht, keys[i], keys[i]);
+        long long d = adv_monotonic_ns() - s;
+        if (d > worst) worst = d;
+        if (i == NUM_KEYS / 2) print_stats("half-way", ht);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  insert            : %7.1f ns/op, worst single insert %.1f us\n",
+           (double)dt / (double)NUM_KEYS, (double)worst / 1000.0);
+    print_stats("after inserts", ht);
+
+    long found = 0;
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (ht_get(ht, keys[i])) found++;
+    }
+    dt = adv_monotonic_ns() - t0;
+    printf("  get (hit)         : %7.1f ns/op%s\n", (double)dt / (double)NUM_KEYS,
+           found == NUM_KEYS ? "" : "  (MISSING KEYS!)");
+
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (ht_get(ht, absent[i])) found++;
+    }
+    dt = adv_monotonic_ns() - t0;
+    printf("  get (miss)        : %7.1f ns/op\n", (double)dt / (double)NUM_KEYS);
+
+    const char* batch_keys[LOOKUP_BATCH];
+    void* batch_vals[LOOKUP_BATCH];
+    int miss_pass;
+    for (miss_pass = 0; miss_pass < 2; miss_pass++) {
+        char (*src)[32] = miss_pass ? absent : keys;
+        long batch_found = 0;
+        t0 = adv_monotonic_ns();
+        for (i = 0; i < NUM_KEYS; i += LOOKUP_BATCH) {
+            long j, m = NUM_KEYS - i < LOOKUP_BATCH ? NUM_KEYS - i : LOOKUP_BATCH;
+            for (j = 0; j < m; j++) batch_keys[j] = src[i + j];
+            batch_found += (long)ht_get_batch(ht, batch_keys, (size_t)m, batch_vals);
+        }
+        dt = adv_monotonic_ns() - t0;
+        printf("  %-18s: %7.1f ns/op%s\n", miss_pass ? "get_batch (miss)" : "get_batch (hit)",
+               (double)dt / (double)NUM_KEYS,
+               batch_found == (miss_pass ? 0 : NUM_KEYS) ? "" : "  (WRONG RESULTS!)");
+    }
+
+    t0 = adv_monotonic_ns();
+    ht_destroy(ht);
+    dt = adv_monotonic_ns() - t0;
+    printf("  destroy           : %7.1f ms\n", (double)dt / 1e6);
+
+    const char** ptrs = (const char**)malloc((size_t)NUM_KEYS * sizeof(*ptrs));
+    for (i = 0; i < NUM_KEYS; i++) ptrs[i] = keys[i];
+    ht = ht_create(16);
+    t0 = adv_monotonic_ns();
+    ht_insert_bulk(ht, ptrs, (void* const*)ptrs, (size_t)NUM_KEYS);
+    dt = adv_monotonic_ns() - t0;
+    printf("  insert_bulk       : %7.1f ns/op\n", (double)dt / (double)NUM_KEYS);
+    print_stats("after bulk", ht);
+    ht_destroy(ht);
+    free(ptrs);
+    free(keys);
+    free(absent);
+}
+
+static unsigned long long g_rng = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long next_rand(void) {
+    /* xorshift64 */
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static void bench_churn(void) {
+    long* live = (long*)malloc((size_t)CHURN_LIVE * sizeof(long));
+    long next_id = 0, i;
+    char key[32];
+    int round;
+    HashTable* ht = ht_create(16);
+    for (i = 0; i < CHURN_LIVE; i++) {
+        live[i] = next_id++;
+        snprintf(key, sizeof(key), "churn:%ld", live[i]);
+        ht_insert(ht, key, live);
+    }
+    for (round = 0; round < CHURN_ROUNDS; round++) {
+        long long t0 = adv_monotonic_ns();
+        for (i = 0; i < CHURN_OPS; i++) {
+            long victim = (long)(next_rand() % (unsigned long long)CHURN_LIVE);
+            snprintf(key, sizeof(key), "churn:%ld", live[victim]);
+            ht_remove(ht, key);
+            live[victim] = next_id++;
+            snprintf(key, sizeof(key), "churn:%ld", live[victim]);
+            ht_insert(ht, key, live);
+        }
+        long long dt = adv_monotonic_ns() - t0;
+        HTStats st;
+        ht_stats(ht, &st);
+        printf("  churn round %d     : %5.2f Mops/s, count %zu, capacity %zu, %.1f MB, avg probe %.2f\n",
+               round, 2.0 * CHURN_OPS * 1000.0 / (double)dt, st.count, st.capacity,
+               (double)st.memory_bytes / (1024.0 * 1024.0), st.avg_probe);
+    }
+    ht_destroy(ht);
+    free(live);
+}
+
+int main(void) {
+    printf("=== hashtable_bench ===\n");
+    bench_growth_and_lookup();
+    bench_churn();
+    return 0;
+}
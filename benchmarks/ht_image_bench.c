@@ -0,0 +1,73 @@
+/*
+ * ht_image_bench.c
+ *
+ * Microbenchmark: startup cost of a NUM_KEYS-key table rebuilt from scratch
+ * (ht_insert of every key) against opening a persistent image with
+ * ht_image_open, plus lookup cost and file size of both image layouts.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "containers.h"
+#include "ht_image.h"
+#include "adv_futex.h"
+
+#define NUM_KEYS   1000000L
+#define IMAGE_PATH "ht_image_bench.htimg"
+
+static unsigned long long g_rng = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long next_rand(void) {
+    /* xorshift64 */
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+int main(void) {
+    char (*keys)[24] = malloc((size_t)NUM_KEYS * sizeof(*keys));
+    long i;
+    size_t sum = 0;
+    for (i = 0; i < NUM_KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "%llx", next_rand());
+    }
+    printf("=== ht_image_bench (%ld keys, values = keys) ===\n", NUM_KEYS);
+
+    long long t0 = adv_monotonic_ns();
+    HashTable* ht = ht_create(16);
+    for (i = 0; i < NUM_KEYS; i++) ht_insert(ht, keys[i], keys[i]);
+    printf("  %-28s: %8.2f ms\n", "rebuild with ht_insert", (adv_monotonic_ns() - t0) / 1e6);
+
+    int mode;
+    for (mode = HT_IMAGE_OPEN_ADDRESSING; mode <= HT_IMAGE_PERFECT; mode++) {
+        const char* name = mode == HT_IMAGE_PERFECT ? "perfect" : "open addressing";
+        t0 = adv_monotonic_ns();
+        if (!ht_image_write(ht, IMAGE_PATH, (HTImageMode)mode, NULL, NULL)) {
+            printf("  %s: ht_image_write failed\n", name);
+            continue;
+        }
+        long long t_write = adv_monotonic_ns() - t0;
+        t0 = adv_monotonic_ns();
+        HTImage* img = ht_image_open(IMAGE_PATH);
+        long long t_open = adv_monotonic_ns() - t0;
+        if (!img) {
+            printf("  %s: ht_image_open failed\n", name);
+            continue;
+        }
+        t0 = adv_monotonic_ns();
+        for (i = 0; i < NUM_KEYS; i++) sum += ht_image_get(img, keys[i], NULL) != NULL;
+        long long t_get = adv_monotonic_ns() - t0;
+        printf("  [%s] write %.2f ms, open %.3f ms, get %.1f ns/op, file %.1f MB\n",
+               name, t_write / 1e6, t_open / 1e6, (double)t_get / (double)NUM_KEYS,
+               ht_image_size(img) / (1024.0 * 1024.0));
+        ht_image_close(img);
+    }
+    remove(IMAGE_PATH);
+    ht_destroy(ht);
+
+    printf("  (checksum %zu)\n", sum);
+    free(keys);
+    return 0;
+}
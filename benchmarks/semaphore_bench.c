@@ -0,0 +1,109 @@
+/*
+ * semaphore_bench.c
+ *
+ * Microbenchmark: OS-backed Semaphore vs. user-space FastSemaphore,
+ * both used as a mutex (initial count 1):
+ *   - uncontended wait/post pairs on one thread
+ *   - contended wait/post from several threads around a shared counter
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "adv_thread.h"
+#include "adv_semaphore.h"
+#include "adv_futex.h"
+
+#define UNCONTENDED_ITERS 10000000L
+#define CONTENDED_ITERS   200000L
+#define MAX_THREADS       8
+
+typedef struct {
+    bool           fast;
+    Semaphore      sem;
+    FastSemaphore  fsem;
+    long           iters;
+    volatile long  counter;
+} BenchState;
+
+static void lock(BenchState* st) {
+    if (st->fast) FastSemaphore_wait(&st->fsem);
+    else          Semaphore_wait(&st->sem);
+}
+
+static void unlock(BenchState* st) {
+    if (st->fast) FastSemaphore_post(&st->fsem);
+    else          Semaphore_post(&st->sem);
+}
+
+static void* contended_worker(void* arg) {
+    BenchState* st = (BenchState*)arg;
+    long i;
+    for (i = 0; i < st->iters; i++) {
+        lock(st);
+        st->counter++;
+        unlock(st);
+    }
+    return NULL;
+}
+
+static void state_init(BenchState* st, bool fast, long iters) {
+    st->fast = fast;
+    st->iters = iters;
+    st->counter = 0;
+    if (fast) FastSemaphore_init(&st->fsem, 1, 0);
+    else      Semaphore_init(&st->sem, 1, 1);
+}
+
+static void state_destroy(BenchState* st) {
+    if (st->fast) FastSemaphore_destroy(&st->fsem);
+    else          Semaphore_destroy(&st->sem);
+}
+
+static void bench_uncontended(bool fast) {
+    BenchState st;
+    state_init(&st, fast, UNCONTENDED_ITERS);
+    long long t0 = adv_monotonic_ns();
+    long i;
+    for (i = 0; i < st.iters; i++) {
+        lock(&st);
+        st.counter++;
+        unlock(&st);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  %-14s uncontended       : %7.2f ns/op\n",
+           fast ? "FastSemaphore" : "Semaphore", (double)dt / (double)st.iters);
+    state_destroy(&st);
+}
+
+static void bench_contended(bool fast, int nthreads) {
+    BenchState st;
+    AdvThread threads[MAX_THREADS];
+    int i;
+    state_init(&st, fast, CONTENDED_ITERS);
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < nthreads; i++) {
+        thread_create(&threads[i], contended_worker, &st);
+    }
+    for (i = 0; i < nthreads; i++) {
+        thread_join(&threads[i]);
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    long total = st.iters * nthreads;
+    printf("  %-14s contended, %d thr : %7.2f ns/op%s\n",
+           fast ? "FastSemaphore" : "Semaphore", nthreads,
+           (double)dt / (double)total,
+           (st.counter == total) ? "" : "  (COUNTER MISMATCH!)");
+    state_destroy(&st);
+}
+
+int main(void) {
+    int n;
+    printf("=== semaphore_bench ===\n");
+    bench_uncontended(false);
+    bench_uncontended(true);
+    for (n = 2; n <= MAX_THREADS; n *= 2) {
+        bench_contended(false, n);
+        bench_contended(true, n);
+    }
+    return 0;
+}
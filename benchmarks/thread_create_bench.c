@@ -0,0 +1,88 @@
+/*
+ * thread_create_bench.c
+ *
+ * Microbenchmark: cost of starting and joining short-lived threads.
+ *   - thread_create + thread_join_result, one thread at a time
+ *   - batches of BATCH threads started together, then joined
+ *   - raw pthread_create / CreateThread as a baseline
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "adv_thread.h"
+#include "adv_futex.h"
+
+#define SERIAL_THREADS 20000L
+#define BATCH          8
+#define BATCH_ROUNDS   2500L
+
+static void* echo_routine(void* arg) {
+    return arg;
+}
+
+static void bench_serial(void) {
+    AdvThread t;
+    long i, bad = 0;
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < SERIAL_THREADS; i++) {
+        void* result = NULL;
+        thread_create(&t, echo_routine, (void*)&t);
+        thread_join_result(&t, &result);
+        if (result != (void*)&t) bad++;
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  thread_create, serial        : %8.0f ns/thread%s\n",
+           (double)dt / (double)SERIAL_THREADS, bad ? "  (RESULT MISMATCH!)" : "");
+}
+
+static void bench_batched(void) {
+    AdvThread threads[BATCH];
+    long r;
+    int i;
+    long long t0 = adv_monotonic_ns();
+    for (r = 0; r < BATCH_ROUNDS; r++) {
+        for (i = 0; i < BATCH; i++) {
+            thread_create(&threads[i], echo_routine, NULL);
+        }
+        for (i = 0; i < BATCH; i++) {
+            thread_join(&threads[i]);
+        }
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  thread_create, batches of %-2d: %8.0f ns/thread\n",
+           BATCH, (double)dt / (double)(BATCH_ROUNDS * BATCH));
+}
+
+#ifdef _WIN32
+static DWORD WINAPI raw_routine(LPVOID arg) {
+    (void)arg;
+    return 0;
+}
+#endif
+
+static void bench_raw(void) {
+    long i;
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < SERIAL_THREADS; i++) {
+#ifdef _WIN32
+        HANDLE h = CreateThread(NULL, 0, raw_routine, NULL, 0, NULL);
+        WaitForSingleObject(h, INFINITE);
+        CloseHandle(h);
+#else
+        pthread_t tid;
+        pthread_create(&tid, NULL, echo_routine, NULL);
+        pthread_join(tid, NULL);
+#endif
+    }
+    long long dt = adv_monotonic_ns() - t0;
+    printf("  raw OS thread, serial        : %8.0f ns/thread\n",
+           (double)dt / (double)SERIAL_THREADS);
+}
+
+int main(void) {
+    printf("=== thread_create_bench ===\n");
+    bench_raw();
+    bench_serial();
+    bench_batched();
+    return 0;
+}
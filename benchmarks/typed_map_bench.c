@@ -0,0 +1,86 @@
+/*
+ * typed_map_bench.c
+ *
+ * Microbenchmark: a uint64_t -> uint64_t map generated by TYPED_MAP_DEFINE
+ * against HashTable with the same keys boxed as 8-byte binary keys
+ * (ht_insert_n / ht_get_n) and the values boxed behind pointers.
+ * Measures inserts, hits and misses over NUM_KEYS random keys.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "containers.h"
+#include "typed_map.h"
+#include "adv_futex.h"
+
+#define NUM_KEYS 1000000L
+
+static inline size_t u64_hash(const uint64_t* k) { return (size_t)*k; }
+static inline bool   u64_eq(const uint64_t* a, const uint64_t* b) { return *a == *b; }
+TYPED_MAP_DEFINE(U64Map, uint64_t, uint64_t, u64_hash, u64_eq)
+
+static unsigned long long g_rng = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long next_rand(void) {
+    /* xorshift64 */
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static void report(const char* what, long long dt) {
+    printf("  %-26s: %7.1f ns/op\n", what, (double)dt / (double)NUM_KEYS);
+}
+
+int main(void) {
+    uint64_t* keys = (uint64_t*)malloc((size_t)NUM_KEYS * sizeof(uint64_t));
+    uint64_t* absent = (uint64_t*)malloc((size_t)NUM_KEYS * sizeof(uint64_t));
+    long i;
+    uint64_t sum = 0;
+    for (i = 0; i < NUM_KEYS; i++) {
+        keys[i] = next_rand() | 1;      /* odd: present */
+        absent[i] = next_rand() & ~1ULL; /* even: never inserted */
+    }
+    printf("=== typed_map_bench (%ld uint64_t keys) ===\n", NUM_KEYS);
+
+    U64Map* m = U64Map_create(16);
+    long long t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) U64Map_put(m, keys[i], (uint64_t)i);
+    report("U64Map put", adv_monotonic_ns() - t0);
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) sum += *U64Map_find(m, keys[i]);
+    report("U64Map find (hit)", adv_monotonic_ns() - t0);
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) sum += U64Map_find(m, absent[i]) != NULL;
+    report("U64Map find (miss)", adv_monotonic_ns() - t0);
+    U64Map_destroy(m);
+
+    /* boxed: key bytes through ht_*_n, values as pointers into 'boxes' */
+    uint64_t* boxes = (uint64_t*)malloc((size_t)NUM_KEYS * sizeof(uint64_t));
+    HashTable* ht = ht_create(16);
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) {
+        boxes[i] = (uint64_t)i;
+        ht_insert_n(ht, (const char*)&keys[i], sizeof(uint64_t), &boxes[i]);
+    }
+    report("HashTable insert (boxed)", adv_monotonic_ns() - t0);
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) {
+        sum += *(uint64_t*)ht_get_n(ht, (const char*)&keys[i], sizeof(uint64_t));
+    }
+    report("HashTable get (hit)", adv_monotonic_ns() - t0);
+    t0 = adv_monotonic_ns();
+    for (i = 0; i < NUM_KEYS; i++) {
+        sum += ht_get_n(ht, (const char*)&absent[i], sizeof(uint64_t)) != NULL;
+    }
+    report("HashTable get (miss)", adv_monotonic_ns() - t0);
+    ht_destroy(ht);
+
+    printf("  (checksum %llu)\n", (unsigned long long)sum);
+    free(boxes);
+    free(keys);
+    free(absent);
+    return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * adv_atomic.h
+ *
+ * Minimal atomic operations for C99.
+ * C99 has no <stdatomic.h>, so we wrap the compiler builtins instead:
+ *   - GCC / Clang (including MinGW): __atomic_* builtins.
+ *   - MSVC: Interlocked* intrinsics (every operation is a full barrier there).
+ *
+ * Only the handful of operations the library needs are provided, for
+ * 'int', 'long long', 'size_t' and 'void*' objects. Every function takes an explicit
+ * memory order (ADV_RELAXED, ADV_ACQUIRE, ADV_RELEASE, ADV_ACQ_REL, ADV_SEQ_CST).
+ */
+
+#ifndef ADV_ATOMIC_H
+#define ADV_ATOMIC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+  #include <intrin.h>
+
+  #define ADV_RELAXED 0
+  #define ADV_ACQUIRE 2
+  #define ADV_RELEASE 3
+  #define ADV_ACQ_REL 4
+  #define ADV_SEQ_CST 5
+
+  /* ---------- int ---------- */
+  static __inline int adv_atomic_load_int(const volatile int* p, int order) {
+      int v = *p;
+      (void)order;
+      _ReadWriteBarrier();
+      return v;
+  }
+  static __inline void adv_atomic_store_int(volatile int* p, int v, int order) {
+      (void)order;
+      _InterlockedExchange((volatile long*)p, (long)v);
+  }
+  static __inline int adv_atomic_fetch_add_int(volatile int* p, int v, int order) {
+      (void)order;
+      return (int)_InterlockedExchangeAdd((volatile long*)p, (long)v);
+  }
+  static __inline int adv_atomic_exchange_int(volatile int* p, int v, int order) {
+      (void)order;
+      return (int)_InterlockedExchange((volatile long*)p, (long)v);
+  }
+  static __inline bool adv_atomic_cas_int(volatile int* p, int* expected, int desired, int order) {
+      long prev = _InterlockedCompareExchange((volatile long*)p, (long)desired, (long)*expected);
+      (void)order;
+      if (prev == (long)*expected) return true;
+      *expected = (int)prev;
+      return false;
+  }
+
+  /* ---------- long long ---------- */
+  static __inline long long adv_atomic_load_llong(const volatile long long* p, int order) {
+      (void)order;
+  #ifdef _WIN64
+      long long v = *p;
+      _ReadWriteBarrier();
+      return v;
+  #else
+      /* 64-bit loads are not atomic on x86-32: use a no-op CAS */
+      return _InterlockedCompareExchange64((volatile __int64*)p, 0, 0);
+  #endif
+  }
+  static __inline void adv_atomic_store_llong(volatile long long* p, long long v, int order) {
+      (void)order;
+      _InterlockedExchange64((volatile __int64*)p, (__int64)v);
+  }
+  static __inline long long adv_atomic_fetch_add_llong(volatile long long* p, long long v, int order) {
+      (void)order;
+      return _InterlockedExchangeAdd64((volatile __int64*)p, (__int64)v);
+  }
+
+  /* ---------- size_t ---------- */
+  #ifdef _WIN64
+    #define ADV__IL_ADD(p, v)      _InterlockedExchangeAdd64((volatile __int64*)(p), (__int64)(v))
+    #define ADV__IL_XCHG(p, v)     _InterlockedExchange64((volatile __int64*)(p), (__int64)(v))
+    #define ADV__IL_CAS(p, d, e)   _InterlockedCompareExchange64((volatile __int64*)(p), (__int64)(d), (__int64)(e))
+  #else
+    #define ADV__IL_ADD(p, v)      _InterlockedExchangeAdd((volatile long*)(p), (long)(v))
+    #define ADV__IL_XCHG(p, v)     _InterlockedExchange((volatile long*)(p), (long)(v))
+    #define ADV__IL_CAS(p, d, e)   _InterlockedCompareExchange((volatile long*)(p), (long)(d), (long)(e))
+  #endif
+
+  static __inline size_t adv_atomic_load_size(const volatile size_t* p, int order) {
+      size_t v = *p;
+      (void)order;
+      _ReadWriteBarrier();
+      return v;
+  }
+  static __inline void adv_atomic_store_size(volatile size_t* p, size_t v, int order) {
+      (void)order;
+      ADV__IL_XCHG(p, v);
+  }
+  static __inline size_t adv_atomic_fetch_add_size(volatile size_t* p, size_t v, int order) {
+      (void)order;
+      return (size_t)ADV__IL_ADD(p, v);
+  }
+  static __inline size_t adv_atomic_fetch_sub_size(volatile size_t* p, size_t v, int order) {
+      (void)order;
+      return (size_t)ADV__IL_ADD(p, (size_t)0 - v);
+  }
+  static __inline bool adv_atomic_cas_size(volatile size_t* p, size_t* expected, size_t desired, int order) {
+      size_t prev = (size_t)ADV__IL_CAS(p, desired, *expected);
+      (void)order;
+      if (prev == *expected) return true;
+      *expected = prev;
+      return false;
+  }
+
+  /* ---------- void* ---------- */
+  static __inline void* adv_atomic_load_ptr(void* const volatile* p, int order) {
+      void* v = *p;
+      (void)order;
+      _ReadWriteBarrier();
+      return v;
+  }
+  static __inline void adv_atomic_store_ptr(void* volatile* p, void* v, int order) {
+      (void)order;
+      _InterlockedExchangePointer(p, v);
+  }
+  static __inline void* adv_atomic_exchange_ptr(void* volatile* p, void* v, int order) {
+      (void)order;
+      return _InterlockedExchangePointer(p, v);
+  }
+  static __inline bool adv_atomic_cas_ptr(void* volatile* p, void** expected, void* desired, int order) {
+      void* prev = _InterlockedCompareExchangePointer(p, desired, *expected);
+      (void)order;
+      if (prev == *expected) return true;
+      *expected = prev;
+      return false;
+  }
+
+  static __inline void adv_atomic_fence(int order) {
+      (void)order;
+      MemoryBarrier();
+  }
+
+  /* CPU hint for spin-wait loops */
+  static __inline void adv_cpu_relax(void) {
+  #if defined(_M_IX86) || defined(_M_X64)
+      _mm_pause();
+  #elif defined(_M_ARM) || defined(_M_ARM64)
+      __yield();
+  #endif
+  }
+
+#elif defined(__GNUC__) || defined(__clang__)
+
+  #define ADV_RELAXED __ATOMIC_RELAXED
+  #define ADV_ACQUIRE __ATOMIC_ACQUIRE
+  #define ADV_RELEASE __ATOMIC_RELEASE
+  #define ADV_ACQ_REL __ATOMIC_ACQ_REL
+  #define ADV_SEQ_CST __ATOMIC_SEQ_CST
+
+  /* ---------- int ---------- */
+  static inline int adv_atomic_load_int(const volatile int* p, int order) {
+      return __atomic_load_n(p, order);
+  }
+  static inline void adv_atomic_store_int(volatile int* p, int v, int order) {
+      __atomic_store_n(p, v, order);
+  }
+  static inline int adv_atomic_fetch_add_int(volatile int* p, int v, int order) {
+      return __atomic_fetch_add(p, v, order);
+  }
+  static inline int adv_atomic_exchange_int(volatile int* p, int v, int order) {
+      return __atomic_exchange_n(p, v, order);
+  }
+  static inline bool adv_atomic_cas_int(volatile int* p, int* expected, int desired, int order) {
+      return __atomic_compare_exchange_n(p, expected, desired, false, order, ADV_RELAXED);
+  }
+
+  /* ---------- long long ---------- */
+  static inline long long adv_atomic_load_llong(const volatile long long* p, int order) {
+      return __atomic_load_n(p, order);
+  }
+  static inline void adv_atomic_store_llong(volatile long long* p, long long v, int order) {
+      __atomic_store_n(p, v, order);
+  }
+  static inline long long adv_atomic_fetch_add_llong(volatile long long* p, long long v, int order) {
+      return __atomic_fetch_add(p, v, order);
+  }
+
+  /* ---------- size_t ---------- */
+  static inline size_t adv_atomic_load_size(const volatile size_t* p, int order) {
+      return __atomic_load_n(p, order);
+  }
+  static inline void adv_atomic_store_size(volatile size_t* p, size_t v, int order) {
+      __atomic_store_n(p, v, order);
+  }
+  static inline size_t adv_atomic_fetch_add_size(volatile size_t* p, size_t v, int order) {
+      return __atomic_fetch_add(p, v, order);
+  }
+  static inline size_t adv_atomic_fetch_sub_size(volatile size_t* p, size_t v, int order) {
+      return __atomic_fetch_sub(p, v, order);
+  }
+  static inline bool adv_atomic_cas_size(volatile size_t* p, size_t* expected, size_t desired, int order) {
+      return __atomic_compare_exchange_n(p, expected, desired, false, order, ADV_RELAXED);
+  }
+
+  /* ---------- void* ---------- */
+  static inline void* adv_atomic_load_ptr(void* const volatile* p, int order) {
+      return __atomic_load_n(p, order);
+  }
+  static inline void adv_atomic_store_ptr(void* volatile* p, void* v, int order) {
+      __atomic_store_n(p, v, order);
+  }
+  static inline void* adv_atomic_exchange_ptr(void* volatile* p, void* v, int order) {
+      return __atomic_exchange_n(p, v, order);
+  }
+  static inline bool adv_atomic_cas_ptr(void* volatile* p, void** expected, void* desired, int order) {
+      return __atomic_compare_exchange_n(p, expected, desired, false, order, ADV_RELAXED);
+  }
+
+  static inline void adv_atomic_fence(int order) {
+      __atomic_thread_fence(order);
+  }
+
+  /* CPU hint for spin-wait loops */
+  static inline void adv_cpu_relax(void) {
+  #if defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+  #elif defined(__aarch64__) || defined(__arm__)
+      __asm__ __volatile__("yield" ::: "memory");
+  #else
+      __asm__ __volatile__("" ::: "memory");
+  #endif
+  }
+
+#else
+  #error "Unsupported compiler for adv_atomic!"
+#endif
+
+#endif // ADV_ATOMIC_H
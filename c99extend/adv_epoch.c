@@ -0,0 +1,333 @@
+/*
+ * adv_epoch.c
+ *
+ * Implementation of epoch-based reclamation.
+ *
+ * Classic three-epoch scheme: a thread inside a read-side section announces
+ * the global epoch it saw. The global epoch may only move from E to E+1 when
+ * every active thread announced E. A pointer retired while the global epoch
+ * was E is therefore unreachable by any reader once the epoch reached E+2.
+ */
+
+#include "adv_epoch.h"
+#include "adv_atomic.h"
+#include "adv_mutex.h"
+#include "adv_thread.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+#define EPOCH_CACHE_LINE 64
+
+typedef struct {
+    void*       ptr;
+    EpochFreeFn free_fn;
+} EpochRetired;
+
+/* Pointers retired during one epoch */
+typedef struct EpochBag {
+    EpochRetired*    items;
+    size_t           count;
+    size_t           capacity;
+    size_t           epoch;
+    struct EpochBag* next;   /* only used on the domain's orphan list */
+} EpochBag;
+
+/*
+ * One record per registered thread, cache-line aligned so that announcing an
+ * epoch never writes a line another thread writes.
+ * 'state' is 0 outside a read-side section, (epoch << 1) | 1 inside one.
+ */
+typedef struct EpochRecord {
+    volatile size_t     state;
+    unsigned int        nesting;   /* owner only */
+    size_t              pending;   /* retires since the last reclamation attempt (owner only) */
+    EpochBag            bags[3];   /* indexed by epoch % 3 (owner only) */
+    struct EpochRecord* prev;
+    struct EpochRecord* next;
+    EpochDomain*        owner;
+    void*               raw;       /* unaligned block returned by malloc */
+} EpochRecord;
+
+struct EpochDomain {
+    volatile size_t epoch;
+    size_t          batch;
+    size_t          id;       /* unique per domain, keys the per-thread record cache */
+    ThreadLocal     key;      /* the calling thread's EpochRecord */
+    Mutex           lock;     /* protects 'records' and 'orphans', serializes advances */
+    EpochRecord*    records;
+    EpochBag*       orphans;  /* bags left behind by exited threads */
+};
+
+/*
+ * One-entry cache of the calling thread's record, so the read-side fast path
+ * skips the ThreadLocal lookup. Keyed by domain id, not address, because a
+ * new domain may be allocated where a destroyed one used to be.
+ */
+static volatile size_t g_next_domain_id = 1;
+static ADV_THREAD_LOCAL size_t       t_cached_id = 0;
+static ADV_THREAD_LOCAL EpochRecord* t_cached_record = NULL;
+
+/* ---------- bags ---------- */
+
+static size_t _epoch_bag_free(EpochBag* bag) {
+    size_t i, n = bag->count;
+    for (i = 0; i < n; i++) {
+        bag->items[i].free_fn(bag->items[i].ptr);
+    }
+    bag->count = 0;
+    return n;
+}
+
+static bool _epoch_bag_push(EpochBag* bag, void* ptr, EpochFreeFn free_fn) {
+    if (bag->count == bag->capacity) {
+        size_t cap = bag->capacity ? bag->capacity * 2 : 16;
+        EpochRetired* items = (EpochRetired*)realloc(bag->items, cap * sizeof(EpochRetired));
+        if (!items) return false;
+        bag->items = items;
+        bag->capacity = cap;
+    }
+    bag->items[bag->count].ptr = ptr;
+    bag->items[bag->count].free_fn = free_fn;
+    bag->count++;
+    return true;
+}
+
+/* ---------- epoch advance (caller holds d->lock) ---------- */
+
+static bool _epoch_try_advance_locked(EpochDomain* d) {
+    size_t g = adv_atomic_load_size(&d->epoch, ADV_RELAXED);
+    const EpochRecord* r;
+    for (r = d->records; r; r = r->next) {
+        size_t s = adv_atomic_load_size(&r->state, ADV_SEQ_CST);
+        if ((s & 1) && (s >> 1) != g) {
+            return false; // a reader is still in an older epoch
+        }
+    }
+    adv_atomic_store_size(&d->epoch, g + 1, ADV_SEQ_CST);
+
+    /* orphaned bags that became safe are freed by whoever advances */
+    EpochBag** link = &d->orphans;
+    while (*link) {
+        EpochBag* bag = *link;
+        if (bag->epoch + 2 <= g + 1) {
+            *link = bag->next;
+            _epoch_bag_free(bag);
+            free(bag->items);
+            free(bag);
+        } else {
+            link = &bag->next;
+        }
+    }
+    return true;
+}
+
+static bool _epoch_try_advance(EpochDomain* d) {
+    Mutex_lock(&d->lock);
+    bool ok = _epoch_try_advance_locked(d);
+    Mutex_unlock(&d->lock);
+    return ok;
+}
+
+/* Frees the record's bags that are at least two epochs old. */
+static size_t _epoch_free_safe_bags(EpochDomain* d, EpochRecord* rec) {
+    size_t g = adv_atomic_load_size(&d->epoch, ADV_ACQUIRE);
+    size_t freed = 0;
+    int i;
+    for (i = 0; i < 3; i++) {
+        EpochBag* bag = &rec->bags[i];
+        if (bag->count && bag->epoch + 2 <= g) {
+            freed += _epoch_bag_free(bag);
+        }
+    }
+    return freed;
+}
+
+/* ---------- thread registration ---------- */
+
+/* Runs at thread exit: hand leftover bags to the domain and drop the record. */
+static void _epoch_record_release(void* p) {
+    EpochRecord* rec = (EpochRecord*)p;
+    EpochDomain* d = rec->owner;
+    int i;
+    if (t_cached_record == rec) {
+        t_cached_id = 0;
+        t_cached_record = NULL;
+    }
+    Mutex_lock(&d->lock);
+    if (rec->prev) rec->prev->next = rec->next;
+    else           d->records = rec->next;
+    if (rec->next) rec->next->prev = rec->prev;
+    for (i = 0; i < 3; i++) {
+        EpochBag* bag = &rec->bags[i];
+        EpochBag* orphan = bag->count ? (EpochBag*)malloc(sizeof(EpochBag)) : NULL;
+        if (orphan) {
+            *orphan = *bag;
+            orphan->next = d->orphans;
+            d->orphans = orphan;
+        } else {
+            /* nothing to keep, or no memory left: better leak than free too early */
+            if (!bag->count) free(bag->items);
+        }
+    }
+    Mutex_unlock(&d->lock);
+    free(rec->raw);
+}
+
+static EpochRecord* _epoch_record_register(EpochDomain* d) {
+    void* raw = malloc(sizeof(EpochRecord) + 2 * EPOCH_CACHE_LINE);
+    if (!raw) return NULL;
+    /* round up to the next line, and keep the line after the record unused as well */
+    uintptr_t addr = ((uintptr_t)raw + EPOCH_CACHE_LINE - 1) & ~(uintptr_t)(EPOCH_CACHE_LINE - 1);
+    EpochRecord* rec = (EpochRecord*)addr;
+    int i;
+    rec->state   = 0;
+    rec->nesting = 0;
+    rec->pending = 0;
+    for (i = 0; i < 3; i++) {
+        rec->bags[i].items = NULL;
+        rec->bags[i].count = 0;
+        rec->bags[i].capacity = 0;
+        rec->bags[i].epoch = 0;
+        rec->bags[i].next = NULL;
+    }
+    rec->owner = d;
+    rec->raw   = raw;
+    rec->prev  = NULL;
+
+    Mutex_lock(&d->lock);
+    rec->next = d->records;
+    if (d->records) d->records->prev = rec;
+    d->records = rec;
+    Mutex_unlock(&d->lock);
+
+    if (!ThreadLocal_set(&d->key, rec)) {
+        _epoch_record_release(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+static EpochRecord* _epoch_record(EpochDomain* d) {
+    if (t_cached_id == d->id) return t_cached_record;
+    EpochRecord* rec = (EpochRecord*)ThreadLocal_get(&d->key);
+    if (!rec) rec = _epoch_record_register(d);
+    if (rec) {
+        t_cached_id = d->id;
+        t_cached_record = rec;
+    }
+    return rec;
+}
+
+/* ---------- public API ---------- */
+
+EpochDomain* EpochDomain_create(size_t batch) {
+    EpochDomain* d = (EpochDomain*)malloc(sizeof(EpochDomain));
+    if (!d) return NULL;
+    if (!ThreadLocal_init(&d->key, _epoch_record_release)) {
+        free(d);
+        return NULL;
+    }
+    Mutex_init(&d->lock, MUTEX_DEFAULT_SPIN);
+    d->epoch   = 0;
+    d->batch   = batch ? batch : EPOCH_DEFAULT_BATCH;
+    d->id      = adv_atomic_fetch_add_size(&g_next_domain_id, 1, ADV_RELAXED);
+    d->records = NULL;
+    d->orphans = NULL;
+    return d;
+}
+
+void EpochDomain_destroy(EpochDomain* d) {
+    if (!d) return;
+    /* first the key (Windows may still run destructors here, which take the lock) */
+    ThreadLocal_destroy(&d->key);
+    EpochRecord* rec = d->records;
+    while (rec) {
+        EpochRecord* next = rec->next;
+        int i;
+        for (i = 0; i < 3; i++) {
+            _epoch_bag_free(&rec->bags[i]);
+            free(rec->bags[i].items);
+        }
+        free(rec->raw);
+        rec = next;
+    }
+    EpochBag* bag = d->orphans;
+    while (bag) {
+        EpochBag* next = bag->next;
+        _epoch_bag_free(bag);
+        free(bag->items);
+        free(bag);
+        bag = next;
+    }
+    Mutex_destroy(&d->lock);
+    free(d);
+}
+
+void EpochDomain_enter(EpochDomain* d) {
+    if (!d) return;
+    EpochRecord* rec = _epoch_record(d);
+    if (!rec || rec->nesting++ > 0) return;
+    for (;;) {
+        size_t g = adv_atomic_load_size(&d->epoch, ADV_RELAXED);
+        adv_atomic_store_size(&rec->state, (g << 1) | 1, ADV_RELAXED);
+        /* the announcement must be visible before we read any shared pointer */
+        adv_atomic_fence(ADV_SEQ_CST);
+        /* if the epoch moved meanwhile, an advancer may have missed us: announce again */
+        if (adv_atomic_load_size(&d->epoch, ADV_RELAXED) == g) break;
+    }
+}
+
+void EpochDomain_exit(EpochDomain* d) {
+    if (!d) return;
+    EpochRecord* rec = (t_cached_id == d->id) ? t_cached_record
+                                              : (EpochRecord*)ThreadLocal_get(&d->key);
+    if (!rec || rec->nesting == 0) return;
+    if (--rec->nesting == 0) {
+        adv_atomic_store_size(&rec->state, 0, ADV_RELEASE);
+    }
+}
+
+void EpochDomain_retire(EpochDomain* d, void* ptr, EpochFreeFn free_fn) {
+    if (!d || !ptr || !free_fn) return;
+    EpochRecord* rec = _epoch_record(d);
+    if (!rec) return; // cannot track it: leaking is the only safe option
+
+    size_t g = adv_atomic_load_size(&d->epoch, ADV_ACQUIRE);
+    EpochBag* bag = &rec->bags[g % 3];
+    if (bag->epoch != g) {
+        /* same slot, older epoch => at least three epochs old, safe to free now */
+        _epoch_bag_free(bag);
+        bag->epoch = g;
+    }
+    if (!_epoch_bag_push(bag, ptr, free_fn)) return;
+
+    if (++rec->pending >= d->batch) {
+        rec->pending = 0;
+        _epoch_try_advance(d);
+        _epoch_free_safe_bags(d, rec);
+    }
+}
+
+size_t EpochDomain_collect(EpochDomain* d) {
+    if (!d) return 0;
+    EpochRecord* rec = _epoch_record(d);
+    if (!rec) return 0;
+    _epoch_try_advance(d);
+    rec->pending = 0;
+    return _epoch_free_safe_bags(d, rec);
+}
+
+void EpochDomain_synchronize(EpochDomain* d) {
+    if (!d) return;
+    EpochRecord* rec = _epoch_record(d);
+    if (!rec) return;
+    size_t target = adv_atomic_load_size(&d->epoch, ADV_ACQUIRE) + 2;
+    int rounds = 0;
+    while (adv_atomic_load_size(&d->epoch, ADV_ACQUIRE) < target) {
+        if (_epoch_try_advance(d)) continue;
+        if (++rounds < 64) adv_cpu_relax();
+        else               Thread_yield();
+    }
+    rec->pending = 0;
+    _epoch_free_safe_bags(d, rec);
+}
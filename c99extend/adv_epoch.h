@@ -0,0 +1,77 @@
+/*
+ * adv_epoch.h
+ *
+ * Epoch-based memory reclamation (EBR) in C99.
+ *
+ * Lock-free readers wrap their accesses to a shared structure in
+ * EpochDomain_enter / EpochDomain_exit. A writer that unlinks a node does not
+ * free it right away but hands it to EpochDomain_retire; the node is freed
+ * once every thread that could still hold a pointer to it has left its
+ * read-side section (two epoch advances later).
+ *
+ * Threads register with a domain on their first enter/retire and are removed
+ * automatically when they exit (through a ThreadLocal destructor), so any
+ * AdvThread / Thread, or any other OS thread, can use a domain directly.
+ *
+ * Retired pointers are collected in per-thread bags and freed in batches:
+ * the epoch is only advanced (which scans the registered threads) once a
+ * thread has retired 'batch' objects, so the cost is amortized.
+ */
+
+#ifndef ADV_EPOCH_H
+#define ADV_EPOCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct EpochDomain EpochDomain;
+
+/* Called on each retired pointer once no reader can reach it (e.g. 'free'). */
+typedef void (*EpochFreeFn)(void* ptr);
+
+/* Retires per thread between two reclamation attempts when 'batch' == 0 */
+#define EPOCH_DEFAULT_BATCH 64
+
+/*
+ * Creates a domain. 'batch' is the number of retires after which a thread
+ * tries to advance the epoch and free what became safe (0 = EPOCH_DEFAULT_BATCH).
+ * Returns NULL on allocation failure.
+ */
+EpochDomain* EpochDomain_create(size_t batch);
+
+/*
+ * Frees every pointer still waiting for reclamation, then the domain.
+ * No thread may be inside a read-side section or still using the domain.
+ */
+void   EpochDomain_destroy(EpochDomain* d);
+
+/*
+ * Begins / ends a read-side section. Sections nest; pointers loaded from the
+ * shared structure stay valid until the outermost EpochDomain_exit.
+ * enter costs one store and one fence, exit a single release store.
+ */
+void   EpochDomain_enter(EpochDomain* d);
+void   EpochDomain_exit(EpochDomain* d);
+
+/*
+ * Defers 'free_fn(ptr)' until no reader can still see 'ptr'. The caller must
+ * already have unlinked 'ptr' from the shared structure. May be called inside
+ * or outside a read-side section.
+ */
+void   EpochDomain_retire(EpochDomain* d, void* ptr, EpochFreeFn free_fn);
+
+/*
+ * Tries to advance the epoch once and frees the calling thread's retired
+ * pointers that became safe. Never blocks on readers.
+ * Returns the number of pointers freed.
+ */
+size_t EpochDomain_collect(EpochDomain* d);
+
+/*
+ * Waits until every read-side section that was active on entry has ended,
+ * then frees everything the calling thread retired (like RCU's synchronize).
+ * Must not be called from inside a read-side section.
+ */
+void   EpochDomain_synchronize(EpochDomain* d);
+
+#endif // ADV_EPOCH_H
@@ -0,0 +1,193 @@
+/*
+ * adv_futex.c
+ *
+ * Implementation of the cross-platform "wait on address" primitive.
+ */
+
+#if defined(__linux__)
+  #define _GNU_SOURCE
+#endif
+
+#include "adv_futex.h"
+
+#if defined(_WIN32)
+/* ===================== Windows ===================== */
+#include <windows.h>
+/* WaitOnAddress lives in Synchronization.lib (Windows 8+) */
+#if defined(_MSC_VER)
+  #pragma comment(lib, "Synchronization.lib")
+#endif
+
+bool adv_futex_wait(volatile int* addr, int expected, long long timeout_ns) {
+    DWORD ms = INFINITE;
+    if (timeout_ns >= 0) {
+        long long rounded = (timeout_ns + 999999LL) / 1000000LL;
+        ms = (rounded >= (long long)INFINITE) ? (INFINITE - 1) : (DWORD)rounded;
+    }
+    if (!WaitOnAddress(addr, &expected, sizeof(int), ms)) {
+        return GetLastError() != ERROR_TIMEOUT;
+    }
+    return true;
+}
+
+void adv_futex_wake(volatile int* addr, int count) {
+    if (count <= 0) return;
+    if (count == 1) {
+        WakeByAddressSingle((PVOID)addr);
+        return;
+    }
+    /* There is no "wake N" on Windows; waking everyone is the cheapest
+       single call, and waiters re-check their condition anyway. */
+    WakeByAddressAll((PVOID)addr);
+}
+
+void adv_futex_wake_all(volatile int* addr) {
+    WakeByAddressAll((PVOID)addr);
+}
+
+long long adv_monotonic_ns(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (long long)((now.QuadPart / freq.QuadPart) * 1000000000LL +
+                       ((now.QuadPart % freq.QuadPart) * 1000000000LL) / freq.QuadPart);
+}
+
+/* ===================== Linux (futex) ===================== */
+#elif defined(__linux__)
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+bool adv_futex_wait(volatile int* addr, int expected, long long timeout_ns) {
+    struct timespec ts;
+    struct timespec* pts = NULL;
+    if (timeout_ns >= 0) {
+        ts.tv_sec  = (time_t)(timeout_ns / 1000000000LL);
+        ts.tv_nsec = (long)(timeout_ns % 1000000000LL);
+        pts = &ts;
+    }
+    /* FUTEX_WAIT takes a relative timeout measured against CLOCK_MONOTONIC */
+    long rc = syscall(SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, expected, pts, NULL, 0);
+    if (rc == -1 && errno == ETIMEDOUT) {
+        return false;
+    }
+    return true;
+}
+
+void adv_futex_wake(volatile int* addr, int count) {
+    if (count <= 0) return;
+    syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+void adv_futex_wake_all(volatile int* addr) {
+    syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+long long adv_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
+}
+
+/* ===================== Other POSIX (macOS, BSD) ===================== */
+#elif defined(__unix__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+
+#include <pthread.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+
+/* largest value of the (signed) time_t, whatever its width */
+#define ADV_TIME_T_MAX ((time_t)((((time_t)1 << (sizeof(time_t) * CHAR_BIT - 2)) - 1) * 2 + 1))
+
+/*
+ * "Parking lot": waiters sleep on the condition variable of the bucket their
+ * address hashes to. A bucket may be shared by several addresses, so wakes
+ * are always broadcasts and waiters treat them as possibly spurious.
+ */
+#define ADV_FUTEX_BUCKETS 64
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+} FutexBucket;
+
+static FutexBucket    g_buckets[ADV_FUTEX_BUCKETS];
+static pthread_once_t g_buckets_once = PTHREAD_ONCE_INIT;
+
+static void _futex_buckets_init(void) {
+    size_t i;
+    for (i = 0; i < ADV_FUTEX_BUCKETS; i++) {
+        pthread_mutex_init(&g_buckets[i].mutex, NULL);
+        pthread_cond_init(&g_buckets[i].cond, NULL);
+    }
+}
+
+static FutexBucket* _futex_bucket(volatile int* addr) {
+    uintptr_t a = (uintptr_t)addr;
+    pthread_once(&g_buckets_once, _futex_buckets_init);
+    /* drop the low bits (ints are 4-byte aligned) and mix a little */
+    a = (a >> 2) ^ (a >> 9);
+    return &g_buckets[a % ADV_FUTEX_BUCKETS];
+}
+
+bool adv_futex_wait(volatile int* addr, int expected, long long timeout_ns) {
+    FutexBucket* b = _futex_bucket(addr);
+    bool woken = true;
+
+    pthread_mutex_lock(&b->mutex);
+    if (__atomic_load_n(addr, __ATOMIC_SEQ_CST) == expected) {
+        if (timeout_ns < 0 || timeout_ns > LLONG_MAX / 2) {
+            /* huge timeouts are effectively infinite; no deadline arithmetic to overflow */
+            pthread_cond_wait(&b->cond, &b->mutex);
+        } else {
+            /* pthread_cond_timedwait wants an absolute CLOCK_REALTIME deadline */
+            struct timespec abs;
+            clock_gettime(CLOCK_REALTIME, &abs);
+            long long ns  = (long long)abs.tv_nsec + timeout_ns % 1000000000LL;
+            long long sec = timeout_ns / 1000000000LL + ns / 1000000000LL;
+            abs.tv_nsec = (long)(ns % 1000000000LL);
+            /* saturate rather than wrap a 32-bit time_t into the past */
+            if (sec > (long long)(ADV_TIME_T_MAX - abs.tv_sec)) {
+                abs.tv_sec = ADV_TIME_T_MAX;
+            } else {
+                abs.tv_sec += (time_t)sec;
+            }
+            if (pthread_cond_timedwait(&b->cond, &b->mutex, &abs) != 0) {
+                woken = false;
+            }
+        }
+    }
+    pthread_mutex_unlock(&b->mutex);
+    return woken;
+}
+
+void adv_futex_wake(volatile int* addr, int count) {
+    if (count <= 0) return;
+    adv_futex_wake_all(addr);
+}
+
+void adv_futex_wake_all(volatile int* addr) {
+    FutexBucket* b = _futex_bucket(addr);
+    pthread_mutex_lock(&b->mutex);
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->mutex);
+}
+
+long long adv_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
+}
+
+#else
+#error "Unsupported platform for adv_futex!"
+#endif
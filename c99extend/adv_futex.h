@@ -0,0 +1,44 @@
+/*
+ * adv_futex.h
+ *
+ * Cross-platform "wait on address" primitive in C99.
+ * On Linux, uses the futex syscall (FUTEX_WAIT_PRIVATE / FUTEX_WAKE_PRIVATE).
+ * On Windows, uses WaitOnAddress / WakeByAddressSingle / WakeByAddressAll.
+ * Elsewhere (macOS, BSD), we fall back to a small table of mutex + condition
+ * variable buckets, hashed by address.
+ *
+ * This is the low-level building block of the semaphore and the other
+ * synchronization primitives; most user code should not need it directly.
+ */
+
+#ifndef ADV_FUTEX_H
+#define ADV_FUTEX_H
+
+#include <stdbool.h>
+
+/*
+ * Blocks the calling thread while '*addr == expected'.
+ * 'timeout_ns' is relative; pass a negative value to wait forever.
+ *
+ * May return spuriously, so callers must re-check their condition in a loop.
+ * Returns false only if the timeout expired, true otherwise.
+ */
+bool adv_futex_wait(volatile int* addr, int expected, long long timeout_ns);
+
+/*
+ * Wakes up to 'count' threads blocked in adv_futex_wait on 'addr'.
+ * On Linux this is a single syscall regardless of 'count'.
+ */
+void adv_futex_wake(volatile int* addr, int count);
+
+/*
+ * Wakes every thread blocked in adv_futex_wait on 'addr'.
+ */
+void adv_futex_wake_all(volatile int* addr);
+
+/*
+ * Monotonic clock in nanoseconds (arbitrary epoch), used to compute deadlines.
+ */
+long long adv_monotonic_ns(void);
+
+#endif // ADV_FUTEX_H
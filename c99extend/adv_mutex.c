@@ -0,0 +1,349 @@
+/*
+ * adv_mutex.c
+ *
+ * Implementation of the cross-platform Mutex, RWLock and CondVar.
+ */
+
+#if defined(__linux__)
+  #define _GNU_SOURCE
+#endif
+
+#include "adv_mutex.h"
+#include "adv_atomic.h"
+
+#if defined(_WIN32)
+/* ===================== Windows ===================== */
+
+bool Mutex_init(Mutex* m, unsigned int spin_count) {
+    if (!m) return false;
+    InitializeSRWLock(&m->lock);
+    m->spin_count = spin_count;
+    return true;
+}
+
+void Mutex_destroy(Mutex* m) {
+    // SRW locks need no cleanup
+    (void)m;
+}
+
+bool Mutex_try_lock(Mutex* m) {
+    if (!m) return false;
+    return TryAcquireSRWLockExclusive(&m->lock) != 0;
+}
+
+void Mutex_lock(Mutex* m) {
+    if (!m) return;
+    unsigned int i;
+    for (i = 0; i < m->spin_count; i++) {
+        if (TryAcquireSRWLockExclusive(&m->lock)) return;
+        adv_cpu_relax();
+    }
+    AcquireSRWLockExclusive(&m->lock);
+}
+
+void Mutex_unlock(Mutex* m) {
+    if (!m) return;
+    ReleaseSRWLockExclusive(&m->lock);
+}
+
+bool RWLock_init(RWLock* rw, unsigned int spin_count) {
+    if (!rw) return false;
+    InitializeSRWLock(&rw->lock);
+    rw->spin_count = spin_count;
+    return true;
+}
+
+void RWLock_destroy(RWLock* rw) {
+    (void)rw;
+}
+
+bool RWLock_try_read_lock(RWLock* rw) {
+    if (!rw) return false;
+    return TryAcquireSRWLockShared(&rw->lock) != 0;
+}
+
+void RWLock_read_lock(RWLock* rw) {
+    if (!rw) return;
+    unsigned int i;
+    for (i = 0; i < rw->spin_count; i++) {
+        if (TryAcquireSRWLockShared(&rw->lock)) return;
+        adv_cpu_relax();
+    }
+    AcquireSRWLockShared(&rw->lock);
+}
+
+void RWLock_read_unlock(RWLock* rw) {
+    if (!rw) return;
+    ReleaseSRWLockShared(&rw->lock);
+}
+
+bool RWLock_try_write_lock(RWLock* rw) {
+    if (!rw) return false;
+    return TryAcquireSRWLockExclusive(&rw->lock) != 0;
+}
+
+void RWLock_write_lock(RWLock* rw) {
+    if (!rw) return;
+    unsigned int i;
+    for (i = 0; i < rw->spin_count; i++) {
+        if (TryAcquireSRWLockExclusive(&rw->lock)) return;
+        adv_cpu_relax();
+    }
+    AcquireSRWLockExclusive(&rw->lock);
+}
+
+void RWLock_write_unlock(RWLock* rw) {
+    if (!rw) return;
+    ReleaseSRWLockExclusive(&rw->lock);
+}
+
+bool CondVar_init(CondVar* c) {
+    if (!c) return false;
+    InitializeConditionVariable(&c->cond);
+    return true;
+}
+
+void CondVar_destroy(CondVar* c) {
+    (void)c;
+}
+
+void CondVar_wait(CondVar* c, Mutex* m) {
+    if (!c || !m) return;
+    SleepConditionVariableSRW(&c->cond, &m->lock, INFINITE, 0);
+}
+
+bool CondVar_timed_wait(CondVar* c, Mutex* m, unsigned long long timeout_ns) {
+    if (!c || !m) return false;
+    unsigned long long ms = (timeout_ns + 999999ULL) / 1000000ULL;
+    DWORD wait_ms = (ms >= (unsigned long long)INFINITE) ? (INFINITE - 1) : (DWORD)ms;
+    if (!SleepConditionVariableSRW(&c->cond, &m->lock, wait_ms, 0)) {
+        return GetLastError() != ERROR_TIMEOUT;
+    }
+    return true;
+}
+
+void CondVar_signal(CondVar* c) {
+    if (!c) return;
+    WakeConditionVariable(&c->cond);
+}
+
+void CondVar_broadcast(CondVar* c) {
+    if (!c) return;
+    WakeAllConditionVariable(&c->cond);
+}
+
+/* ===================== POSIX ===================== */
+#else
+
+#include "adv_futex.h"
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+/* largest value of the (signed) time_t, whatever its width */
+#define ADV_TIME_T_MAX ((time_t)((((time_t)1 << (sizeof(time_t) * CHAR_BIT - 2)) - 1) * 2 + 1))
+
+/* ---------- Mutex ---------- */
+
+bool Mutex_init(Mutex* m, unsigned int spin_count) {
+    if (!m) return false;
+    m->spin_count = spin_count;
+    // default attributes: no priority inheritance, no robustness => pure user-space fast path
+    return pthread_mutex_init(&m->mutex, NULL) == 0;
+}
+
+void Mutex_destroy(Mutex* m) {
+    if (!m) return;
+    pthread_mutex_destroy(&m->mutex);
+}
+
+bool Mutex_try_lock(Mutex* m) {
+    if (!m) return false;
+    return pthread_mutex_trylock(&m->mutex) == 0;
+}
+
+void Mutex_lock(Mutex* m) {
+    if (!m) return;
+    unsigned int i;
+    for (i = 0; i < m->spin_count; i++) {
+        if (pthread_mutex_trylock(&m->mutex) == 0) return;
+        adv_cpu_relax();
+    }
+    pthread_mutex_lock(&m->mutex);
+}
+
+void Mutex_unlock(Mutex* m) {
+    if (!m) return;
+    pthread_mutex_unlock(&m->mutex);
+}
+
+/* ---------- RWLock (atomics + futex) ---------- */
+
+/*
+ * Sleepers wait on 'epoch', never on 'state': any release that could let
+ * someone in bumps 'epoch' and, if 'sleepers' is non-zero, wakes them all.
+ * A sleeper reads 'epoch' before announcing itself and re-checking 'state',
+ * and the releaser changes 'state' before bumping 'epoch' and reading
+ * 'sleepers' (all seq_cst), so a release can never slip between a sleeper's
+ * check and its futex wait.
+ */
+static void _rwlock_wake(RWLock* rw) {
+    adv_atomic_fetch_add_int(&rw->epoch, 1, ADV_SEQ_CST);
+    if (adv_atomic_load_int(&rw->sleepers, ADV_SEQ_CST) > 0) {
+        adv_futex_wake_all(&rw->epoch);
+    }
+}
+
+static bool _rwlock_read_ready(RWLock* rw) {
+    return adv_atomic_load_int(&rw->state, ADV_SEQ_CST) >= 0
+        && adv_atomic_load_int(&rw->writers_waiting, ADV_SEQ_CST) == 0;
+}
+
+bool RWLock_init(RWLock* rw, unsigned int spin_count) {
+    if (!rw) return false;
+    rw->state = 0;
+    rw->writers_waiting = 0;
+    rw->epoch = 0;
+    rw->sleepers = 0;
+    rw->spin_count = spin_count;
+    return true;
+}
+
+void RWLock_destroy(RWLock* rw) {
+    // nothing to release: the lock is just a few ints
+    (void)rw;
+}
+
+bool RWLock_try_read_lock(RWLock* rw) {
+    if (!rw) return false;
+    int s = adv_atomic_load_int(&rw->state, ADV_RELAXED);
+    while (s >= 0 && adv_atomic_load_int(&rw->writers_waiting, ADV_RELAXED) == 0) {
+        if (adv_atomic_cas_int(&rw->state, &s, s + 1, ADV_ACQUIRE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RWLock_read_lock(RWLock* rw) {
+    if (!rw) return;
+    unsigned int i;
+    for (i = 0; i <= rw->spin_count; i++) {
+        if (RWLock_try_read_lock(rw)) return;
+        adv_cpu_relax();
+    }
+    for (;;) {
+        int e = adv_atomic_load_int(&rw->epoch, ADV_SEQ_CST);
+        adv_atomic_fetch_add_int(&rw->sleepers, 1, ADV_SEQ_CST);
+        if (!_rwlock_read_ready(rw)) {
+            adv_futex_wait(&rw->epoch, e, -1);
+        }
+        adv_atomic_fetch_add_int(&rw->sleepers, -1, ADV_RELAXED);
+        if (RWLock_try_read_lock(rw)) return;
+    }
+}
+
+void RWLock_read_unlock(RWLock* rw) {
+    if (!rw) return;
+    // the last reader out may let a writer in
+    if (adv_atomic_fetch_add_int(&rw->state, -1, ADV_SEQ_CST) == 1) {
+        _rwlock_wake(rw);
+    }
+}
+
+bool RWLock_try_write_lock(RWLock* rw) {
+    if (!rw) return false;
+    int expected = 0;
+    return adv_atomic_cas_int(&rw->state, &expected, -1, ADV_ACQUIRE);
+}
+
+void RWLock_write_lock(RWLock* rw) {
+    if (!rw) return;
+    unsigned int i;
+    for (i = 0; i <= rw->spin_count; i++) {
+        if (RWLock_try_write_lock(rw)) return;
+        adv_cpu_relax();
+    }
+    // from here on, new readers hold back until we got the lock
+    adv_atomic_fetch_add_int(&rw->writers_waiting, 1, ADV_SEQ_CST);
+    for (;;) {
+        int e = adv_atomic_load_int(&rw->epoch, ADV_SEQ_CST);
+        if (RWLock_try_write_lock(rw)) break;
+        adv_atomic_fetch_add_int(&rw->sleepers, 1, ADV_SEQ_CST);
+        if (adv_atomic_load_int(&rw->state, ADV_SEQ_CST) != 0) {
+            adv_futex_wait(&rw->epoch, e, -1);
+        }
+        adv_atomic_fetch_add_int(&rw->sleepers, -1, ADV_RELAXED);
+    }
+    adv_atomic_fetch_add_int(&rw->writers_waiting, -1, ADV_SEQ_CST);
+}
+
+void RWLock_write_unlock(RWLock* rw) {
+    if (!rw) return;
+    adv_atomic_store_int(&rw->state, 0, ADV_SEQ_CST);
+    _rwlock_wake(rw);
+}
+
+/* ---------- CondVar ---------- */
+
+bool CondVar_init(CondVar* c) {
+    if (!c) return false;
+#if defined(__linux__)
+    // measure timeouts on the monotonic clock, immune to wall-clock jumps
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int rc = pthread_cond_init(&c->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return rc == 0;
+#else
+    return pthread_cond_init(&c->cond, NULL) == 0;
+#endif
+}
+
+void CondVar_destroy(CondVar* c) {
+    if (!c) return;
+    pthread_cond_destroy(&c->cond);
+}
+
+void CondVar_wait(CondVar* c, Mutex* m) {
+    if (!c || !m) return;
+    pthread_cond_wait(&c->cond, &m->mutex);
+}
+
+bool CondVar_timed_wait(CondVar* c, Mutex* m, unsigned long long timeout_ns) {
+    if (!c || !m) return false;
+    if (timeout_ns > (unsigned long long)LLONG_MAX / 2) {
+        // effectively infinite; keeps the deadline arithmetic from overflowing
+        pthread_cond_wait(&c->cond, &m->mutex);
+        return true;
+    }
+    struct timespec abs;
+#if defined(__linux__)
+    clock_gettime(CLOCK_MONOTONIC, &abs);
+#else
+    clock_gettime(CLOCK_REALTIME, &abs);
+#endif
+    unsigned long long ns  = (unsigned long long)abs.tv_nsec + timeout_ns % 1000000000ULL;
+    unsigned long long sec = timeout_ns / 1000000000ULL + ns / 1000000000ULL;
+    abs.tv_nsec = (long)(ns % 1000000000ULL);
+    // saturate rather than wrap a 32-bit time_t into the past
+    if (sec > (unsigned long long)(ADV_TIME_T_MAX - abs.tv_sec)) {
+        abs.tv_sec = ADV_TIME_T_MAX;
+    } else {
+        abs.tv_sec += (time_t)sec;
+    }
+    return pthread_cond_timedwait(&c->cond, &m->mutex, &abs) != ETIMEDOUT;
+}
+
+void CondVar_signal(CondVar* c) {
+    if (!c) return;
+    pthread_cond_signal(&c->cond);
+}
+
+void CondVar_broadcast(CondVar* c) {
+    if (!c) return;
+    pthread_cond_broadcast(&c->cond);
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * adv_mutex.h
+ *
+ * Cross-platform locks in C99:
+ *   - Mutex:   exclusive lock, with an optional adaptive spin phase.
+ *   - RWLock:  reader/writer lock (shared readers, exclusive writer, writers preferred).
+ *   - CondVar: condition variable paired with a Mutex.
+ *
+ * On Windows, uses SRWLOCK and CONDITION_VARIABLE.
+ * On POSIX, Mutex/CondVar wrap pthread_mutex_t / pthread_cond_t (default, non
+ * priority-inheriting attributes, so the uncontended path never enters the kernel).
+ * pthread_rwlock_t is not visible in strict C99 mode, so the POSIX RWLock is
+ * built on atomics + adv_futex instead.
+ */
+
+#ifndef ADV_MUTEX_H
+#define ADV_MUTEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+
+  #include <windows.h>
+  typedef struct Mutex {
+      SRWLOCK      lock;
+      unsigned int spin_count;
+  } Mutex;
+
+  typedef struct RWLock {
+      SRWLOCK      lock;
+      unsigned int spin_count;
+  } RWLock;
+
+  typedef struct CondVar {
+      CONDITION_VARIABLE cond;
+  } CondVar;
+
+#elif defined(__unix__) || defined(__APPLE__) || defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+
+  #include <pthread.h>
+  typedef struct Mutex {
+      pthread_mutex_t mutex;
+      unsigned int    spin_count;
+  } Mutex;
+
+  typedef struct RWLock {
+      volatile int state;           // > 0: readers holding, -1: writer holding, 0: free
+      volatile int writers_waiting; // blocks new readers while > 0
+      volatile int epoch;           // futex word, bumped on every release that can unblock someone
+      volatile int sleepers;        // threads sleeping (or about to sleep) on 'epoch'
+      unsigned int spin_count;
+  } RWLock;
+
+  typedef struct CondVar {
+      pthread_cond_t cond;
+  } CondVar;
+
+#else
+  #error "Unsupported platform for adv_mutex!"
+#endif
+
+/* A reasonable spin budget for locks that guard short critical sections */
+#define MUTEX_DEFAULT_SPIN 100
+
+/*
+ * ---------------------------------------------------------
+ * Mutex
+ * ---------------------------------------------------------
+ * 'spin_count' > 0 enables the adaptive phase: before blocking, lock() retries
+ * try_lock up to 'spin_count' times with a CPU pause in between. Use 0 for a
+ * plain blocking mutex.
+ *
+ * Returns true on success, false on failure.
+ */
+bool Mutex_init(Mutex* m, unsigned int spin_count);
+void Mutex_destroy(Mutex* m);
+void Mutex_lock(Mutex* m);
+bool Mutex_try_lock(Mutex* m);
+void Mutex_unlock(Mutex* m);
+
+/*
+ * ---------------------------------------------------------
+ * RWLock
+ * ---------------------------------------------------------
+ * Any number of readers, or one writer. A waiting writer blocks new readers,
+ * so writers cannot starve under a steady stream of readers.
+ * 'spin_count' works as for Mutex.
+ */
+bool RWLock_init(RWLock* rw, unsigned int spin_count);
+void RWLock_destroy(RWLock* rw);
+void RWLock_read_lock(RWLock* rw);
+bool RWLock_try_read_lock(RWLock* rw);
+void RWLock_read_unlock(RWLock* rw);
+void RWLock_write_lock(RWLock* rw);
+bool RWLock_try_write_lock(RWLock* rw);
+void RWLock_write_unlock(RWLock* rw);
+
+/*
+ * ---------------------------------------------------------
+ * CondVar
+ * ---------------------------------------------------------
+ * Always used with a locked Mutex. Wake-ups may be spurious, so wait in a loop.
+ */
+bool CondVar_init(CondVar* c);
+void CondVar_destroy(CondVar* c);
+void CondVar_wait(CondVar* c, Mutex* m);
+
+/*
+ * Waits at most 'timeout_ns' nanoseconds.
+ * Returns false on timeout, true if signaled (or woken spuriously).
+ */
+bool CondVar_timed_wait(CondVar* c, Mutex* m, unsigned long long timeout_ns);
+void CondVar_signal(CondVar* c);
+void CondVar_broadcast(CondVar* c);
+
+#endif // ADV_MUTEX_H
@@ -29,14 +29,33 @@ void Semaphore_wait(Semaphore* s) {
     WaitForSingleObject(s->handle, INFINITE);
 }
 
+bool Semaphore_try_wait(Semaphore* s) {
+    if (!s) return false;
+    return WaitForSingleObject(s->handle, 0) == WAIT_OBJECT_0;
+}
+
+bool Semaphore_timed_wait(Semaphore* s, unsigned long long timeout_ns) {
+    if (!s) return false;
+    // round up to whole milliseconds, staying below INFINITE
+    unsigned long long ms = (timeout_ns + 999999ULL) / 1000000ULL;
+    DWORD wait_ms = (ms >= (unsigned long long)INFINITE) ? (INFINITE - 1) : (DWORD)ms;
+    return WaitForSingleObject(s->handle, wait_ms) == WAIT_OBJECT_0;
+}
+
 void Semaphore_post(Semaphore* s) {
     if (!s) return;
     ReleaseSemaphore(s->handle, 1, NULL);
 }
 
+void Semaphore_post_n(Semaphore* s, unsigned int count) {
+    if (!s || count == 0) return;
+    ReleaseSemaphore(s->handle, (LONG)count, NULL);
+}
+
 /* ===================== macOS (GCD) ===================== */
 #elif defined(__APPLE__)
 #include <limits.h> // for INT_MAX if needed
+#include <stdint.h> // for INT64_MAX
 
 bool Semaphore_init(Semaphore* s, unsigned int initial_count, unsigned int max_count) {
     if (!s) return false;
@@ -64,16 +83,134 @@ void Semaphore_wait(Semaphore* s) {
     dispatch_semaphore_wait(s->sem, DISPATCH_TIME_FOREVER);
 }
 
+bool Semaphore_try_wait(Semaphore* s) {
+    if (!s || !s->sem) return false;
+    return dispatch_semaphore_wait(s->sem, DISPATCH_TIME_NOW) == 0;
+}
+
+bool Semaphore_timed_wait(Semaphore* s, unsigned long long timeout_ns) {
+    if (!s || !s->sem) return false;
+    // dispatch_time takes a signed delta; saturate huge timeouts
+    int64_t delta = (timeout_ns > (unsigned long long)INT64_MAX) ? INT64_MAX : (int64_t)timeout_ns;
+    return dispatch_semaphore_wait(s->sem, dispatch_time(DISPATCH_TIME_NOW, delta)) == 0;
+}
+
 void Semaphore_post(Semaphore* s) {
     if (!s || !s->sem) return;
     dispatch_semaphore_signal(s->sem);
 }
 
-/* ===================== POSIX (Linux/BSD) ===================== */
-#elif defined(__unix__) || defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+void Semaphore_post_n(Semaphore* s, unsigned int count) {
+    if (!s || !s->sem) return;
+    // GCD has no batched signal
+    while (count--) {
+        dispatch_semaphore_signal(s->sem);
+    }
+}
+
+/* ===================== Linux (atomic count + futex) ===================== */
+#elif defined(__linux__)
+
+#include "adv_atomic.h"
+#include "adv_futex.h"
+#include <limits.h>
+
+bool Semaphore_init(Semaphore* s, unsigned int initial_count, unsigned int max_count) {
+    if (!s) return false;
+    // max_count is not enforced, like on the other POSIX systems.
+    s->count   = (initial_count > INT_MAX) ? INT_MAX : (int)initial_count;
+    s->waiters = 0;
+    (void)max_count;
+    return true;
+}
+
+void Semaphore_destroy(Semaphore* s) {
+    // nothing to release: the semaphore is just two ints
+    (void)s;
+}
+
+bool Semaphore_try_wait(Semaphore* s) {
+    if (!s) return false;
+    int c = adv_atomic_load_int(&s->count, ADV_RELAXED);
+    while (c > 0) {
+        if (adv_atomic_cas_int(&s->count, &c, c - 1, ADV_ACQUIRE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Common slow path. 'timeout_ns' < 0 => wait forever.
+ *
+ * The waiter announces itself in 'waiters' before re-reading 'count', and the
+ * poster bumps 'count' before reading 'waiters' (both seq_cst), so at least one
+ * side always sees the other: either the waiter sees the new permit, or the
+ * poster sees the waiter and issues the futex wake.
+ */
+static bool _semaphore_wait_ns(Semaphore* s, long long timeout_ns) {
+    long long deadline = 0;
+    if (timeout_ns > 0) {
+        deadline = adv_monotonic_ns() + timeout_ns;
+    }
+    for (;;) {
+        if (Semaphore_try_wait(s)) {
+            return true;
+        }
+        long long remaining = -1;
+        if (timeout_ns >= 0) {
+            remaining = (timeout_ns == 0) ? 0 : deadline - adv_monotonic_ns();
+            if (remaining <= 0) {
+                return false;
+            }
+        }
+        adv_atomic_fetch_add_int(&s->waiters, 1, ADV_SEQ_CST);
+        if (adv_atomic_load_int(&s->count, ADV_SEQ_CST) == 0) {
+            adv_futex_wait(&s->count, 0, remaining);
+        }
+        adv_atomic_fetch_add_int(&s->waiters, -1, ADV_RELAXED);
+    }
+}
+
+void Semaphore_wait(Semaphore* s) {
+    if (!s) return;
+    _semaphore_wait_ns(s, -1);
+}
+
+bool Semaphore_timed_wait(Semaphore* s, unsigned long long timeout_ns) {
+    if (!s) return false;
+    if (timeout_ns > (unsigned long long)LLONG_MAX / 2) {
+        // effectively infinite; keeps the deadline arithmetic from overflowing
+        _semaphore_wait_ns(s, -1);
+        return true;
+    }
+    return _semaphore_wait_ns(s, (long long)timeout_ns);
+}
+
+void Semaphore_post(Semaphore* s) {
+    Semaphore_post_n(s, 1);
+}
+
+void Semaphore_post_n(Semaphore* s, unsigned int count) {
+    if (!s || count == 0) return;
+    int n = (count > INT_MAX) ? INT_MAX : (int)count;
+    adv_atomic_fetch_add_int(&s->count, n, ADV_SEQ_CST);
+    if (adv_atomic_load_int(&s->waiters, ADV_SEQ_CST) > 0) {
+        // one syscall wakes up to 'n' sleepers
+        adv_futex_wake(&s->count, n);
+    }
+}
+
+/* ===================== POSIX (BSD) ===================== */
+#elif defined(__unix__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
 
 #include <semaphore.h>
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+/* largest value of the (signed) time_t, whatever its width */
+#define ADV_TIME_T_MAX ((time_t)((((time_t)1 << (sizeof(time_t) * CHAR_BIT - 2)) - 1) * 2 + 1))
 
 bool Semaphore_init(Semaphore* s, unsigned int initial_count, unsigned int max_count) {
     if (!s) return false;
@@ -96,11 +233,420 @@ void Semaphore_wait(Semaphore* s) {
     sem_wait(&s->sem);
 }
 
+bool Semaphore_try_wait(Semaphore* s) {
+    if (!s) return false;
+    return sem_trywait(&s->sem) == 0;
+}
+
+bool Semaphore_timed_wait(Semaphore* s, unsigned long long timeout_ns) {
+    if (!s) return false;
+    if (timeout_ns > (unsigned long long)LLONG_MAX / 2) {
+        // effectively infinite; keeps the deadline arithmetic from overflowing
+        Semaphore_wait(s);
+        return true;
+    }
+    // sem_timedwait wants an absolute CLOCK_REALTIME deadline
+    struct timespec abs;
+    clock_gettime(CLOCK_REALTIME, &abs);
+    unsigned long long ns  = (unsigned long long)abs.tv_nsec + timeout_ns % 1000000000ULL;
+    unsigned long long sec = timeout_ns / 1000000000ULL + ns / 1000000000ULL;
+    abs.tv_nsec = (long)(ns % 1000000000ULL);
+    // saturate rather than wrap a 32-bit time_t into the past
+    if (sec > (unsigned long long)(ADV_TIME_T_MAX - abs.tv_sec)) {
+        abs.tv_sec = ADV_TIME_T_MAX;
+    } else {
+        abs.tv_sec += (time_t)sec;
+    }
+    int rc;
+    do {
+        rc = sem_timedwait(&s->sem, &abs);
+    } while (rc != 0 && errno == EINTR);
+    return rc == 0;
+}
+
 void Semaphore_post(Semaphore* s) {
     if (!s) return;
     sem_post(&s->sem);
 }
 
+void Semaphore_post_n(Semaphore* s, unsigned int count) {
+    if (!s) return;
+    // POSIX has no batched post
+    while (count--) {
+        sem_post(&s->sem);
+    }
+}
+
 #else
 #error "Unsupported platform for adv_semaphore!"
 #endif
+
+/* ===================== Interruptible wait (all platforms) ===================== */
+
+#include "adv_thread.h"
+
+#if defined(__linux__)
+/*
+ * Same protocol as _semaphore_wait_ns, but the sleep goes through
+ * Thread_block_on, which Thread_request_stop knows how to interrupt.
+ */
+bool Semaphore_wait_interruptible(Semaphore* s) {
+    if (!s) return false;
+    for (;;) {
+        if (Semaphore_try_wait(s)) return true;
+        if (Thread_should_stop()) return false;
+        adv_atomic_fetch_add_int(&s->waiters, 1, ADV_SEQ_CST);
+        if (adv_atomic_load_int(&s->count, ADV_SEQ_CST) == 0) {
+            Thread_block_on(&s->count, 0, -1);
+        }
+        adv_atomic_fetch_add_int(&s->waiters, -1, ADV_RELAXED);
+    }
+}
+#else
+/* No wait-on-address for the OS semaphores here: wait in short slices and poll the stop flag */
+#define SEMAPHORE_STOP_POLL_NS 1000000ULL
+
+bool Semaphore_wait_interruptible(Semaphore* s) {
+    if (!s) return false;
+    if (!Thread_current()) {
+        Semaphore_wait(s);
+        return true;
+    }
+    for (;;) {
+        if (Semaphore_try_wait(s)) return true;
+        if (Thread_should_stop()) return false;
+        if (Semaphore_timed_wait(s, SEMAPHORE_STOP_POLL_NS)) return true;
+    }
+}
+#endif
+
+/* ===================== FastSemaphore (all platforms) ===================== */
+
+#include "adv_atomic.h"
+#include <limits.h>
+#if defined(_WIN32)
+  // SwitchToThread comes from <windows.h>, already included by the header
+#else
+  #include <sched.h>
+#endif
+
+/* After this many spin rounds, each further round yields the CPU instead of pausing */
+#define FAST_SEMAPHORE_YIELD_AFTER 64
+
+static void _fast_semaphore_yield(void) {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+bool FastSemaphore_init(FastSemaphore* s, unsigned int initial_count, unsigned int spin_count) {
+    if (!s) return false;
+    s->count = (initial_count > INT_MAX) ? INT_MAX : (int)initial_count;
+    s->spin_count = (spin_count == 0) ? FAST_SEMAPHORE_DEFAULT_SPIN
+                  : (spin_count > INT_MAX) ? INT_MAX : (int)spin_count;
+    return Semaphore_init(&s->sema, 0, INT_MAX);
+}
+
+void FastSemaphore_destroy(FastSemaphore* s) {
+    if (!s) return;
+    Semaphore_destroy(&s->sema);
+}
+
+bool FastSemaphore_try_wait(FastSemaphore* s) {
+    if (!s) return false;
+    int c = adv_atomic_load_int(&s->count, ADV_RELAXED);
+    while (c > 0) {
+        if (adv_atomic_cas_int(&s->count, &c, c - 1, ADV_ACQUIRE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Spin phase, then register as a waiter and block.
+ * 'timeout_ns' < 0 => wait forever.
+ */
+static bool _fast_semaphore_wait_slow(FastSemaphore* s, long long timeout_ns) {
+    int spin;
+    for (spin = 0; spin < s->spin_count; spin++) {
+        if (FastSemaphore_try_wait(s)) {
+            return true;
+        }
+        if (spin < FAST_SEMAPHORE_YIELD_AFTER) {
+            adv_cpu_relax();
+        } else {
+            _fast_semaphore_yield();
+        }
+    }
+
+    // register: count goes down by one; if it was positive we got a permit after all
+    if (adv_atomic_fetch_add_int(&s->count, -1, ADV_ACQUIRE) > 0) {
+        return true;
+    }
+    if (timeout_ns < 0) {
+        Semaphore_wait(&s->sema);
+        return true;
+    }
+    if (Semaphore_timed_wait(&s->sema, (unsigned long long)timeout_ns)) {
+        return true;
+    }
+
+    /*
+     * Timed out. Unregister by bumping the count back, unless a poster has
+     * already accounted for us (count >= 0), in which case its post to 'sema'
+     * is on the way and must be consumed.
+     */
+    for (;;) {
+        int c = adv_atomic_load_int(&s->count, ADV_RELAXED);
+        if (c >= 0 && Semaphore_try_wait(&s->sema)) {
+            return true;
+        }
+        if (c < 0 && adv_atomic_cas_int(&s->count, &c, c + 1, ADV_RELAXED)) {
+            return false;
+        }
+    }
+}
+
+void FastSemaphore_wait(FastSemaphore* s) {
+    if (!s) return;
+    if (FastSemaphore_try_wait(s)) return;
+    _fast_semaphore_wait_slow(s, -1);
+}
+
+bool FastSemaphore_timed_wait(FastSemaphore* s, unsigned long long timeout_ns) {
+    if (!s) return false;
+    if (FastSemaphore_try_wait(s)) return true;
+    if (timeout_ns == 0) return false;
+    if (timeout_ns > (unsigned long long)LLONG_MAX) {
+        timeout_ns = (unsigned long long)LLONG_MAX;
+    }
+    return _fast_semaphore_wait_slow(s, (long long)timeout_ns);
+}
+
+void FastSemaphore_post(FastSemaphore* s) {
+    FastSemaphore_post_n(s, 1);
+}
+
+void FastSemaphore_post_n(FastSemaphore* s, unsigned int count) {
+    if (!s || count == 0) return;
+    int n = (count > INT_MAX) ? INT_MAX : (int)count;
+    int old = adv_atomic_fetch_add_int(&s->count, n, ADV_RELEASE);
+    // only the waiters that registered (negative count) need an OS-level wake
+    int to_release = (-old < n) ? -old : n;
+    if (to_release > 0) {
+        Semaphore_post_n(&s->sema, (unsigned int)to_release);
+    }
+}
+
+/* ===================== Barrier / Latch / EventCount (all platforms) ===================== */
+
+#include "adv_futex.h"
+
+/* Converts an unsigned timeout into adv_futex terms; huge values mean "forever" (-1) */
+static long long _sync_timeout_ns(unsigned long long timeout_ns) {
+    return (timeout_ns > (unsigned long long)LLONG_MAX / 2) ? -1 : (long long)timeout_ns;
+}
+
+/* ---------- Barrier ---------- */
+
+bool Barrier_init(Barrier* b, unsigned int count, unsigned int spin_count) {
+    if (!b || count == 0 || count > INT_MAX) return false;
+    b->remaining = (int)count;
+    b->sense = 0;
+    b->sleepers = 0;
+    b->count = (int)count;
+    b->spin_count = spin_count;
+    return true;
+}
+
+void Barrier_destroy(Barrier* b) {
+    // nothing to release: the barrier is just a few ints
+    (void)b;
+}
+
+bool Barrier_wait(Barrier* b) {
+    if (!b) return false;
+    // read the phase before arriving: it cannot flip until we did
+    int phase = adv_atomic_load_int(&b->sense, ADV_ACQUIRE);
+
+    if (adv_atomic_fetch_add_int(&b->remaining, -1, ADV_ACQ_REL) == 1) {
+        /*
+         * Last one in: re-arm for the next phase, then release everyone.
+         * Nobody can arrive for the next phase before seeing the flip,
+         * so resetting 'remaining' first is safe.
+         */
+        adv_atomic_store_int(&b->remaining, b->count, ADV_RELAXED);
+        adv_atomic_store_int(&b->sense, phase ^ 1, ADV_SEQ_CST);
+        if (adv_atomic_load_int(&b->sleepers, ADV_SEQ_CST) > 0) {
+            adv_futex_wake_all(&b->sense);
+        }
+        return true;
+    }
+
+    // same spin shape as FastSemaphore: pause first, then yield so a late thread on our CPU can arrive
+    unsigned int i;
+    for (i = 0; i < b->spin_count; i++) {
+        if (adv_atomic_load_int(&b->sense, ADV_ACQUIRE) != phase) return false;
+        if (i < FAST_SEMAPHORE_YIELD_AFTER) adv_cpu_relax();
+        else                                _fast_semaphore_yield();
+    }
+    // same handshake as the Linux Semaphore: announce, then re-check inside the futex wait
+    adv_atomic_fetch_add_int(&b->sleepers, 1, ADV_SEQ_CST);
+    while (adv_atomic_load_int(&b->sense, ADV_SEQ_CST) == phase) {
+        adv_futex_wait(&b->sense, phase, -1);
+    }
+    adv_atomic_fetch_add_int(&b->sleepers, -1, ADV_RELAXED);
+    adv_atomic_fence(ADV_ACQUIRE);
+    return false;
+}
+
+/* ---------- Latch ---------- */
+
+bool Latch_init(Latch* l, unsigned int count) {
+    if (!l) return false;
+    l->count = (count > INT_MAX) ? INT_MAX : (int)count;
+    l->sleepers = 0;
+    return true;
+}
+
+void Latch_destroy(Latch* l) {
+    (void)l;
+}
+
+void Latch_count_down(Latch* l, unsigned int n) {
+    if (!l || n == 0) return;
+    int dec = (n > INT_MAX) ? INT_MAX : (int)n;
+    int c = adv_atomic_load_int(&l->count, ADV_RELAXED);
+    while (c > 0) {
+        int next = (c > dec) ? c - dec : 0;
+        if (adv_atomic_cas_int(&l->count, &c, next, ADV_SEQ_CST)) {
+            if (next == 0 && adv_atomic_load_int(&l->sleepers, ADV_SEQ_CST) > 0) {
+                adv_futex_wake_all(&l->count);
+            }
+            return;
+        }
+    }
+}
+
+bool Latch_try_wait(Latch* l) {
+    if (!l) return false;
+    return adv_atomic_load_int(&l->count, ADV_ACQUIRE) == 0;
+}
+
+static bool _latch_wait_ns(Latch* l, long long timeout_ns) {
+    long long deadline = (timeout_ns > 0) ? adv_monotonic_ns() + timeout_ns : 0;
+    bool done = true;
+    adv_atomic_fetch_add_int(&l->sleepers, 1, ADV_SEQ_CST);
+    for (;;) {
+        int c = adv_atomic_load_int(&l->count, ADV_SEQ_CST);
+        if (c == 0) break;
+        long long remaining = -1;
+        if (timeout_ns >= 0) {
+            remaining = (timeout_ns == 0) ? 0 : deadline - adv_monotonic_ns();
+            if (remaining <= 0) {
+                done = false;
+                break;
+            }
+        }
+        // non-final count_downs change 'count' without a wake; we just re-arm with the new value
+        adv_futex_wait(&l->count, c, remaining);
+    }
+    adv_atomic_fetch_add_int(&l->sleepers, -1, ADV_RELAXED);
+    adv_atomic_fence(ADV_ACQUIRE);
+    return done;
+}
+
+void Latch_wait(Latch* l) {
+    if (!l || Latch_try_wait(l)) return;
+    _latch_wait_ns(l, -1);
+}
+
+bool Latch_timed_wait(Latch* l, unsigned long long timeout_ns) {
+    if (!l) return false;
+    if (Latch_try_wait(l)) return true;
+    return _latch_wait_ns(l, _sync_timeout_ns(timeout_ns));
+}
+
+/* ---------- EventCount ---------- */
+
+bool EventCount_init(EventCount* ec) {
+    if (!ec) return false;
+    ec->epoch = 0;
+    ec->waiters = 0;
+    return true;
+}
+
+void EventCount_destroy(EventCount* ec) {
+    (void)ec;
+}
+
+int EventCount_prepare_wait(EventCount* ec) {
+    if (!ec) return 0;
+    adv_atomic_fetch_add_int(&ec->waiters, 1, ADV_SEQ_CST);
+    return adv_atomic_load_int(&ec->epoch, ADV_SEQ_CST);
+}
+
+void EventCount_cancel_wait(EventCount* ec) {
+    if (!ec) return;
+    adv_atomic_fetch_add_int(&ec->waiters, -1, ADV_RELAXED);
+}
+
+static bool _eventcount_wait_ns(EventCount* ec, int key, long long timeout_ns) {
+    long long deadline = (timeout_ns > 0) ? adv_monotonic_ns() + timeout_ns : 0;
+    bool notified = true;
+    while (adv_atomic_load_int(&ec->epoch, ADV_SEQ_CST) == key) {
+        long long remaining = -1;
+        if (timeout_ns >= 0) {
+            remaining = (timeout_ns == 0) ? 0 : deadline - adv_monotonic_ns();
+            if (remaining <= 0) {
+                notified = false;
+                break;
+            }
+        }
+        adv_futex_wait(&ec->epoch, key, remaining);
+    }
+    adv_atomic_fetch_add_int(&ec->waiters, -1, ADV_RELAXED);
+    adv_atomic_fence(ADV_ACQUIRE);
+    return notified;
+}
+
+void EventCount_wait(EventCount* ec, int key) {
+    if (!ec) return;
+    _eventcount_wait_ns(ec, key, -1);
+}
+
+bool EventCount_timed_wait(EventCount* ec, int key, unsigned long long timeout_ns) {
+    if (!ec) return false;
+    return _eventcount_wait_ns(ec, key, _sync_timeout_ns(timeout_ns));
+}
+
+/*
+ * The fence orders the caller's state change before the 'waiters' check;
+ * paired with the seq_cst increment in prepare_wait, either the notifier
+ * sees the waiter, or the waiter's re-check sees the new state.
+ */
+static bool _eventcount_bump(EventCount* ec) {
+    adv_atomic_fence(ADV_SEQ_CST);
+    if (adv_atomic_load_int(&ec->waiters, ADV_RELAXED) == 0) {
+        return false;
+    }
+    adv_atomic_fetch_add_int(&ec->epoch, 1, ADV_SEQ_CST);
+    return true;
+}
+
+void EventCount_notify_one(EventCount* ec) {
+    if (!ec) return;
+    if (_eventcount_bump(ec)) {
+        adv_futex_wake(&ec->epoch, 1);
+    }
+}
+
+void EventCount_notify_all(EventCount* ec) {
+    if (!ec) return;
+    if (_eventcount_bump(ec)) {
+        adv_futex_wake_all(&ec->epoch);
+    }
+}
@@ -3,8 +3,12 @@
  *
  * Cross-platform semaphore in C99.
  * On Windows, uses CreateSemaphore / WaitForSingleObject / ReleaseSemaphore.
- * On Linux/BSD, uses sem_init / sem_wait / sem_post (POSIX).
+ * On Linux, uses an atomic counter + futex, so that Semaphore_post_n wakes N waiters in one syscall.
+ * On BSD, uses sem_init / sem_wait / sem_post (POSIX).
  * On Apple (macOS), we switch to dispatch_semaphore if we want to avoid deprecated sem_init.
+ *
+ * Also provides FastSemaphore, Barrier, Latch and EventCount, which are built
+ * on atomics + adv_futex on every platform.
  */
 
 #ifndef ADV_SEMAPHORE_H
@@ -27,7 +31,14 @@
       dispatch_semaphore_t sem;
   } Semaphore;
 
-#elif defined(__unix__) || defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#elif defined(__linux__)
+  // atomic count + futex (see adv_futex.h)
+  typedef struct Semaphore {
+      volatile int count;    // available permits
+      volatile int waiters;  // threads sleeping (or about to sleep) on 'count'
+  } Semaphore;
+
+#elif defined(__unix__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
   // "normal" POSIX semaphores
   #include <semaphore.h>
   typedef struct Semaphore {
@@ -57,9 +68,171 @@ void Semaphore_destroy(Semaphore* s);
  */
 void Semaphore_wait(Semaphore* s);
 
+/*
+ * Try to decrement without blocking.
+ * Returns true if the count was decremented, false if it was zero.
+ */
+bool Semaphore_try_wait(Semaphore* s);
+
+/*
+ * Wait (decrement), blocking for at most 'timeout_ns' nanoseconds.
+ * Returns true if the count was decremented, false on timeout.
+ * A timeout of 0 behaves like Semaphore_try_wait.
+ */
+bool Semaphore_timed_wait(Semaphore* s, unsigned long long timeout_ns);
+
+/*
+ * Wait (decrement) that gives up when the calling Thread is asked to stop
+ * (see Thread_request_stop in adv_thread.h).
+ * Returns true if the count was decremented, false if a stop was requested.
+ * Called outside a Thread, it behaves like Semaphore_wait.
+ */
+bool Semaphore_wait_interruptible(Semaphore* s);
+
 /*
  * Post (increment).
  */
 void Semaphore_post(Semaphore* s);
 
+/*
+ * Post 'count' times at once (increment by 'count').
+ * On Linux this is a single atomic add plus at most one futex wake of 'count' waiters;
+ * on Windows a single ReleaseSemaphore call. Elsewhere it loops over Semaphore_post.
+ */
+void Semaphore_post_n(Semaphore* s, unsigned int count);
+
+/*
+ * ---------------------------------------------------------
+ * FastSemaphore ("benaphore")
+ * ---------------------------------------------------------
+ * A lightweight user-space semaphore: an atomic count that is adjusted
+ * without any syscall while permits are available. A waiter that finds the
+ * count at zero first spins (then yields) for a bounded number of rounds,
+ * and only then registers itself by driving the count negative and sleeps
+ * on the OS Semaphore above. Posters only touch the OS Semaphore when the
+ * count says someone is actually asleep.
+ *
+ * Good as a mutex (initial_count = 1) or for short producer/consumer handoffs.
+ */
+typedef struct FastSemaphore {
+    volatile int count;      // > 0: free permits, < 0: number of sleeping waiters
+    int          spin_count; // spin rounds before sleeping
+    Semaphore    sema;       // slow path, only used under real contention
+} FastSemaphore;
+
+/* Spin rounds used when FastSemaphore_init gets spin_count == 0 */
+#define FAST_SEMAPHORE_DEFAULT_SPIN 256
+
+/*
+ * Initialize with 'initial_count' permits. 'spin_count' bounds the spin phase
+ * (0 = FAST_SEMAPHORE_DEFAULT_SPIN). Returns true on success, false on failure.
+ */
+bool FastSemaphore_init(FastSemaphore* s, unsigned int initial_count, unsigned int spin_count);
+void FastSemaphore_destroy(FastSemaphore* s);
+void FastSemaphore_wait(FastSemaphore* s);
+bool FastSemaphore_try_wait(FastSemaphore* s);
+bool FastSemaphore_timed_wait(FastSemaphore* s, unsigned long long timeout_ns);
+void FastSemaphore_post(FastSemaphore* s);
+void FastSemaphore_post_n(FastSemaphore* s, unsigned int count);
+
+/*
+ * ---------------------------------------------------------
+ * Barrier (reusable, sense-reversing)
+ * ---------------------------------------------------------
+ * 'count' threads call Barrier_wait; none of them returns before all of them
+ * arrived. The barrier then resets itself for the next phase, so the same
+ * Barrier serves every step of a phased loop.
+ *
+ * Waiters first spin on the phase flag for 'spin_count' rounds (pausing, then
+ * yielding, like FastSemaphore; 0 = go straight to sleep), then sleep on it with a futex. The last thread to arrive flips the
+ * flag and issues a single wake-all, only if someone actually went to sleep.
+ */
+typedef struct Barrier {
+    volatile int remaining;  // threads still to arrive in this phase
+    volatile int sense;      // phase flag (0/1), flipped by the last arriving thread
+    volatile int sleepers;   // threads sleeping (or about to sleep) on 'sense'
+    int          count;
+    unsigned int spin_count;
+} Barrier;
+
+/* A spin budget that covers threads arriving within a few microseconds of each other */
+#define BARRIER_DEFAULT_SPIN 256
+
+/* Returns true on success, false if 'count' is 0 or too large. */
+bool Barrier_init(Barrier* b, unsigned int count, unsigned int spin_count);
+void Barrier_destroy(Barrier* b);
+
+/*
+ * Blocks until all 'count' threads have arrived.
+ * Returns true in exactly one thread per phase (the last to arrive), false in the others,
+ * so that thread can do per-phase serial work.
+ */
+bool Barrier_wait(Barrier* b);
+
+/*
+ * ---------------------------------------------------------
+ * Latch (one-shot countdown)
+ * ---------------------------------------------------------
+ * Starts at 'count'; Latch_count_down decrements it, and once it reaches zero
+ * every current and future Latch_wait returns immediately. Unlike a
+ * Semaphore, the zero state is sticky and releases all waiters at once.
+ */
+typedef struct Latch {
+    volatile int count;     // futex word
+    volatile int sleepers;  // threads sleeping (or about to sleep) on 'count'
+} Latch;
+
+bool Latch_init(Latch* l, unsigned int count);
+void Latch_destroy(Latch* l);
+
+/* Decrements by 'n' (clamped at zero); the step that reaches zero wakes all waiters. */
+void Latch_count_down(Latch* l, unsigned int n);
+
+/* Returns true if the count already reached zero. Never blocks. */
+bool Latch_try_wait(Latch* l);
+void Latch_wait(Latch* l);
+
+/* Returns false if the count is still non-zero after 'timeout_ns' nanoseconds. */
+bool Latch_timed_wait(Latch* l, unsigned long long timeout_ns);
+
+/*
+ * ---------------------------------------------------------
+ * EventCount
+ * ---------------------------------------------------------
+ * Lets a consumer of a lock-free structure sleep until "something changed"
+ * without a lock and without losing wake-ups:
+ *
+ *     for (;;) {
+ *         if ((item = try_pop(q))) break;
+ *         int key = EventCount_prepare_wait(&ec);
+ *         if ((item = try_pop(q))) { EventCount_cancel_wait(&ec); break; }
+ *         EventCount_wait(&ec, key);
+ *     }
+ *
+ * and the producer does push(q, item); EventCount_notify_one(&ec);
+ * Notifying costs one fence and one load when nobody is waiting.
+ */
+typedef struct EventCount {
+    volatile int epoch;    // futex word, bumped by every notify that has waiters to wake
+    volatile int waiters;  // threads between prepare_wait and the end of wait / cancel_wait
+} EventCount;
+
+bool EventCount_init(EventCount* ec);
+void EventCount_destroy(EventCount* ec);
+
+/* Registers the caller as a waiter; returns the key to pass to EventCount_wait. */
+int  EventCount_prepare_wait(EventCount* ec);
+
+/* Withdraws a prepare_wait whose condition turned out to be satisfied. */
+void EventCount_cancel_wait(EventCount* ec);
+
+/* Sleeps until a notify after the matching prepare_wait (returns at once if one already happened). */
+void EventCount_wait(EventCount* ec, int key);
+
+/* Like EventCount_wait, but gives up after 'timeout_ns'. Returns false on timeout. */
+bool EventCount_timed_wait(EventCount* ec, int key, unsigned long long timeout_ns);
+
+void EventCount_notify_one(EventCount* ec);
+void EventCount_notify_all(EventCount* ec);
+
 #endif // ADV_SEMAPHORE_H
@@ -4,26 +4,214 @@
  * Implementation of cross-platform Thread + the new thread_create/thread_join.
  */
 
+#if defined(__linux__)
+  #define _GNU_SOURCE   /* pthread_setname_np, pthread_setaffinity_np, CPU_SET */
+#endif
+
 #include "adv_thread.h"
+#include "adv_atomic.h"
+#include "adv_mutex.h"
+#include "adv_futex.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <stdbool.h>
 
+#if !defined(_WIN32)
+  #include <sched.h>
+#endif
+#if defined(__linux__)
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#elif defined(__FreeBSD__) || defined(__OpenBSD__)
+  #include <pthread_np.h>
+#endif
+
 #ifdef _WIN32
 static DWORD WINAPI _thread_bootstrap(LPVOID lpParam);
 #else
 static void* _thread_bootstrap(void* arg);
 #endif
 
+/* The Thread object of the calling thread (set by the bootstrap functions) */
+static ADV_THREAD_LOCAL Thread* g_current_thread = NULL;
+
+/* ========== OS-level thread attributes (name, affinity, scheduling) ========== */
+
+#ifdef _WIN32
+typedef HANDLE    ThreadOsHandle;
+#else
+typedef pthread_t ThreadOsHandle;
+#endif
+
+/* Gives the calling thread its OS-visible name. */
+static void _thread_os_set_name(const char* name) {
+#if defined(_WIN32)
+    /* SetThreadDescription only exists on Windows 10 1607+, so look it up at runtime */
+    typedef HRESULT (WINAPI *SetThreadDescriptionFn)(HANDLE, PCWSTR);
+    HMODULE kernel = GetModuleHandleA("kernel32.dll");
+    SetThreadDescriptionFn fn = kernel ? (SetThreadDescriptionFn)GetProcAddress(kernel, "SetThreadDescription") : NULL;
+    if (fn) {
+        WCHAR wname[64];
+        if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wname, 64) > 0) {
+            fn(GetCurrentThread(), wname);
+        }
+    }
+#elif defined(__linux__)
+    /* the kernel limit is 16 bytes including the terminating NUL */
+    char short_name[16];
+    strncpy(short_name, name, sizeof(short_name) - 1);
+    short_name[sizeof(short_name) - 1] = '\0';
+    pthread_setname_np(pthread_self(), short_name);
+#elif defined(__APPLE__)
+    pthread_setname_np(name);
+#elif defined(__FreeBSD__) || defined(__OpenBSD__)
+    pthread_set_name_np(pthread_self(), name);
+#elif defined(__NetBSD__)
+    pthread_setname_np(pthread_self(), "%s", (void*)name);
+#else
+    (void)name;
+#endif
+}
+
+static bool _thread_os_set_affinity(const Thread* t, ThreadOsHandle h) {
+#if defined(_WIN32)
+    /* processor group 0 only */
+    DWORD_PTR mask = t->has_affinity ? (DWORD_PTR)t->affinity[0] : (DWORD_PTR)-1;
+    if (mask == 0) return false;
+    return SetThreadAffinityMask(h, mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    int cpu;
+    CPU_ZERO(&set);
+    for (cpu = 0; cpu < THREAD_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (!t->has_affinity || (t->affinity[cpu / 64] & (1ULL << (cpu % 64)))) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(h, sizeof(set), &set) == 0;
+#else
+    /* macOS only has affinity "tags", BSDs use non-portable cpuset APIs */
+    (void)t;
+    (void)h;
+    return false;
+#endif
+}
+
+/* 'os_tid' is the kernel thread id (Linux only, may be 0 if not known yet). */
+static bool _thread_os_set_sched(const Thread* t, ThreadOsHandle h, int os_tid) {
+#if defined(_WIN32)
+    int level;
+    (void)os_tid;
+    if (t->sched_policy != THREAD_SCHED_OTHER) {
+        level = THREAD_PRIORITY_TIME_CRITICAL;
+    } else if (t->sched_priority <= -10) {
+        level = THREAD_PRIORITY_HIGHEST;
+    } else if (t->sched_priority < 0) {
+        level = THREAD_PRIORITY_ABOVE_NORMAL;
+    } else if (t->sched_priority == 0) {
+        level = THREAD_PRIORITY_NORMAL;
+    } else if (t->sched_priority < 10) {
+        level = THREAD_PRIORITY_BELOW_NORMAL;
+    } else {
+        level = THREAD_PRIORITY_LOWEST;
+    }
+    return SetThreadPriority(h, level) != 0;
+#else
+    struct sched_param sp;
+    int policy = SCHED_OTHER;
+    memset(&sp, 0, sizeof(sp));
+    if (t->sched_policy == THREAD_SCHED_FIFO) {
+        policy = SCHED_FIFO;
+        sp.sched_priority = t->sched_priority;
+    } else if (t->sched_policy == THREAD_SCHED_RR) {
+        policy = SCHED_RR;
+        sp.sched_priority = t->sched_priority;
+    }
+    if (pthread_setschedparam(h, policy, &sp) != 0) {
+        return false;
+    }
+    if (policy != SCHED_OTHER) {
+        return true;
+    }
+  #if defined(__linux__)
+    /* on Linux, nice is a per-thread attribute addressed by the kernel tid */
+    if (os_tid == 0) {
+        return true; /* not running yet: the thread applies it itself at start */
+    }
+    return setpriority(PRIO_PROCESS, (id_t)os_tid, t->sched_priority) == 0;
+  #else
+    /* elsewhere nice is per-process */
+    (void)os_tid;
+    return t->sched_priority == 0;
+  #endif
+#endif
+}
+
 /*
- * We'll store a small struct to hold the "void*(*)(void*)" function pointer
- * plus its argument, so we can call it inside Thread_run without mismatched casts.
+ * Handshake between the thread applying its own attributes at start and
+ * setters running on other threads (Dekker style, seq_cst fences on both sides):
+ *   thread: attr_state = APPLYING; fence; read fields + apply; attr_state = DONE
+ *   setter: write fields; fence; read attr_state
+ * A setter reading PENDING knows the thread will read the new fields after it.
+ * Otherwise it waits for DONE, so a stale or torn copy the thread may have read
+ * cannot be applied after the setter's own call.
  */
-typedef struct {
-    void *(*start_routine)(void*);
-    void* arg;
-} ThreadTrampoline;
+#define THREAD_ATTR_PENDING  0
+#define THREAD_ATTR_APPLYING 1
+#define THREAD_ATTR_DONE     2
+
+/*
+ * Called by a setter after writing the attribute fields of a started thread.
+ * Returns false if the thread has not applied its attributes yet (it will pick
+ * up the new values), true once the caller has to apply them itself; *os_tid
+ * then holds the published kernel tid.
+ */
+static bool _thread_attr_wait_applied(Thread* t, int* os_tid) {
+    adv_atomic_fence(ADV_SEQ_CST);
+    if (adv_atomic_load_int(&t->attr_state, ADV_RELAXED) == THREAD_ATTR_PENDING) {
+        return false;
+    }
+    while (adv_atomic_load_int(&t->attr_state, ADV_ACQUIRE) != THREAD_ATTR_DONE) {
+        adv_cpu_relax();
+    }
+    *os_tid = adv_atomic_load_int(&t->os_tid, ADV_RELAXED);
+    return true;
+}
+
+/*
+ * Runs on the new thread before the user function: publishes the kernel tid and
+ * applies name, affinity and scheduling. Failures leave the OS defaults in place.
+ */
+static void _thread_apply_os_attributes(Thread* t) {
+#ifdef _WIN32
+    ThreadOsHandle self = GetCurrentThread();
+    int os_tid = 0;
+#else
+    ThreadOsHandle self = pthread_self();
+  #if defined(__linux__)
+    int os_tid = (int)syscall(SYS_gettid);
+  #else
+    int os_tid = 0;
+  #endif
+#endif
+    adv_atomic_store_int(&t->os_tid, os_tid, ADV_RELAXED);
+    /* pairs with the fence in _thread_attr_wait_applied */
+    adv_atomic_store_int(&t->attr_state, THREAD_ATTR_APPLYING, ADV_RELAXED);
+    adv_atomic_fence(ADV_SEQ_CST);
+
+    _thread_os_set_name(t->name);
+    if (t->has_affinity) {
+        (void)_thread_os_set_affinity(t, self);
+    }
+    if (t->has_sched) {
+        (void)_thread_os_set_sched(t, self, os_tid);
+    }
+    adv_atomic_store_int(&t->attr_state, THREAD_ATTR_DONE, ADV_RELEASE);
+}
 
 /* ========== Old "class-like" Thread methods ========== */
 
@@ -35,9 +223,21 @@ void Thread_init(Thread* t, void (*target)(void*), void* arg, const char* name)
     t->started   = false;
     t->joined    = false;
     t->killed    = false;
-    t->is_alive  = false;
+    t->is_alive  = 0;
     t->target    = target;
     t->arg       = arg;
+    t->start_routine = NULL;
+    t->result        = NULL;
+
+    t->has_affinity   = false;
+    memset(t->affinity, 0, sizeof(t->affinity));
+    t->has_sched      = false;
+    t->sched_policy   = THREAD_SCHED_OTHER;
+    t->sched_priority = 0;
+    t->os_tid         = 0;
+    t->attr_state     = THREAD_ATTR_PENDING;
+    t->stop_requested = 0;
+    t->blocked_on     = NULL;
 
     if (name) {
 #ifdef _WIN32
@@ -62,16 +262,15 @@ void Thread_init(Thread* t, void (*target)(void*), void* arg, const char* name)
 }
 
 /*
- * Actually run the thread: if 'target' is the normal function,
- * we just call it. If 'target' is our special trampoline function,
- * we handle that scenario differently.
+ * Actually run the thread: a thread_create thread calls its
+ * 'void* (*)(void*)' start_routine and keeps the result,
+ * otherwise we just call 'target'.
  */
 void Thread_run(Thread* t) {
     if (!t) return;
-    if (t->target) {
-        /* If we detect that 't->target' is our 'trampoline' function,
-           we cast 't->arg' to ThreadTrampoline, call start_routine, free it, etc.
-         */
+    if (t->start_routine) {
+        t->result = t->start_routine(t->arg);
+    } else if (t->target) {
         t->target(t->arg);
     }
 }
@@ -80,18 +279,22 @@ void Thread_run(Thread* t) {
 static DWORD WINAPI _thread_bootstrap(LPVOID lpParam) {
     Thread* t = (Thread*)lpParam;
     if (!t) return 0;
-    t->is_alive = true;
+    g_current_thread = t;
+    _thread_apply_os_attributes(t);
     Thread_run(t);
-    t->is_alive = false;
+    /* publishes 'result' to anyone who sees is_alive == 0 */
+    adv_atomic_store_int(&t->is_alive, 0, ADV_RELEASE);
     return 0;
 }
 #else
 static void* _thread_bootstrap(void* arg) {
     Thread* t = (Thread*)arg;
     if (!t) return NULL;
-    t->is_alive = true;
+    g_current_thread = t;
+    _thread_apply_os_attributes(t);
     Thread_run(t);
-    t->is_alive = false;
+    /* publishes 'result' to anyone who sees is_alive == 0 */
+    adv_atomic_store_int(&t->is_alive, 0, ADV_RELEASE);
     return NULL;
 }
 #endif
@@ -99,6 +302,8 @@ static void* _thread_bootstrap(void* arg) {
 void Thread_start(Thread* t) {
     if (!t || t->started) return;
     t->started = true;
+    /* alive from here on, so Thread_is_alive never reports a thread that has not run yet as dead */
+    adv_atomic_store_int(&t->is_alive, 1, ADV_RELAXED);
 #ifdef _WIN32
     DWORD tid;
     HANDLE h = CreateThread(NULL, 0, _thread_bootstrap, t, 0, &tid);
@@ -107,11 +312,13 @@ void Thread_start(Thread* t) {
         t->thread_id = tid;
     } else {
         t->started = false; // failed
+        adv_atomic_store_int(&t->is_alive, 0, ADV_RELAXED);
     }
 #else
     int rc = pthread_create(&t->thread_id, NULL, _thread_bootstrap, t);
     if (rc != 0) {
         t->started = false; // failed
+        adv_atomic_store_int(&t->is_alive, 0, ADV_RELAXED);
     }
 #endif
 }
@@ -131,21 +338,17 @@ void Thread_join(Thread* t) {
 void Thread_kill(Thread* t) {
     if (!t || !t->started || t->killed) return;
     t->killed = true;
-#ifdef _WIN32
-    if (t->handle) {
-        TerminateThread(t->handle, 0);
-        CloseHandle(t->handle);
-        t->handle = NULL;
-    }
-#else
-    pthread_kill(t->thread_id, SIGKILL);
-#endif
-    t->is_alive = false;
+    Thread_request_stop(t);
 }
 
 bool Thread_is_alive(Thread* t) {
     if (!t) return false;
-    return t->is_alive;
+    return adv_atomic_load_int(&t->is_alive, ADV_ACQUIRE) != 0;
+}
+
+void* Thread_get_result(const Thread* t) {
+    if (!t || adv_atomic_load_int(&t->is_alive, ADV_ACQUIRE)) return NULL;
+    return t->result;
 }
 
 void Thread_set_name(Thread* t, const char* name) {
@@ -164,52 +367,161 @@ const char* Thread_get_name(Thread* t) {
     return t->name;
 }
 
-/* ========== New functions required by thread_pool.c ========== */
-/*
- * We create a small static function that matches 'void(*)(void*)' type
- * but inside it, we safely call the user function returning void*.
- */
+/* ========== Cooperative cancellation ========== */
+
+void Thread_request_stop(Thread* t) {
+    if (!t) return;
+    adv_atomic_store_int(&t->stop_requested, 1, ADV_SEQ_CST);
+    /* Thread_sleep_interruptible sleeps on the flag itself: its value changed, one wake is enough */
+    adv_futex_wake_all(&t->stop_requested);
+
+    /*
+     * If the thread sleeps on some other word (a semaphore, ...), that word's
+     * value did not change, so a wake sent just before the thread's futex wait
+     * would be lost. Keep waking until the thread reports it left Thread_block_on;
+     * once it is out, it sees the flag and will not block again.
+     */
+    int rounds = 0;
+    for (;;) {
+        void* addr = adv_atomic_load_ptr(&t->blocked_on, ADV_SEQ_CST);
+        if (!addr || addr == (void*)&t->stop_requested) break;
+        adv_futex_wake_all((volatile int*)addr);
+        if (++rounds < 16) adv_cpu_relax();
+        else               Thread_yield();
+    }
+}
+
+bool Thread_stop_requested(const Thread* t) {
+    if (!t) return false;
+    return adv_atomic_load_int(&t->stop_requested, ADV_ACQUIRE) != 0;
+}
+
+Thread* Thread_current(void) {
+    return g_current_thread;
+}
+
+bool Thread_should_stop(void) {
+    return Thread_stop_requested(g_current_thread);
+}
+
+void Thread_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+bool Thread_block_on(volatile int* addr, int expected, long long timeout_ns) {
+    Thread* self = g_current_thread;
+    if (!self) {
+        return adv_futex_wait(addr, expected, timeout_ns);
+    }
+    /* publish before checking the flag; Thread_request_stop does the reverse */
+    adv_atomic_store_ptr(&self->blocked_on, (void*)addr, ADV_SEQ_CST);
+    bool woken = true;
+    if (!adv_atomic_load_int(&self->stop_requested, ADV_SEQ_CST)) {
+        woken = adv_futex_wait(addr, expected, timeout_ns);
+    }
+    adv_atomic_store_ptr(&self->blocked_on, NULL, ADV_SEQ_CST);
+    return woken;
+}
+
+bool Thread_sleep_interruptible(unsigned long long timeout_ns) {
+    Thread* self = g_current_thread;
+    volatile int never_set = 0;
+    volatile int* word = self ? &self->stop_requested : &never_set;
+    if (timeout_ns > (unsigned long long)LLONG_MAX / 2) {
+        // effectively infinite: only a stop request ends the sleep
+        while (!self || !Thread_stop_requested(self)) {
+            adv_futex_wait(word, 0, -1);
+        }
+        return false;
+    }
+    long long now = adv_monotonic_ns();
+    long long deadline = ((long long)timeout_ns > LLONG_MAX - now) ? LLONG_MAX
+                                                                   : now + (long long)timeout_ns;
+    for (;;) {
+        if (self && Thread_stop_requested(self)) return false;
+        long long remaining = deadline - adv_monotonic_ns();
+        if (remaining <= 0) return true;
+        adv_futex_wait(word, 0, remaining);
+    }
+}
+
+bool Thread_set_affinity(Thread* t, const int* cpus, size_t ncpus) {
+    if (!t || (ncpus > 0 && !cpus)) return false;
+    unsigned long long mask[THREAD_MAX_CPUS / 64];
+    size_t i;
+    memset(mask, 0, sizeof(mask));
+    for (i = 0; i < ncpus; i++) {
+        if (cpus[i] < 0 || cpus[i] >= THREAD_MAX_CPUS) {
+            return false;
+        }
+        mask[cpus[i] / 64] |= 1ULL << (cpus[i] % 64);
+    }
+    memcpy(t->affinity, mask, sizeof(mask));
+    t->has_affinity = (ncpus > 0);
 
-/* The real trampoline function that we store in 't->target'. */
-static void _thread_routine_trampoline(void* arg) {
-    ThreadTrampoline* td = (ThreadTrampoline*)arg;
-    if (!td) return;
-    /* call the user-provided start_routine (which returns void*) */
-    (void) td->start_routine(td->arg); 
-    /* optional: we could store the return value somewhere if needed. */
+    if (!t->started) {
+#if defined(_WIN32) || defined(__linux__)
+        return true;  /* applied by the thread at start */
+#else
+        t->has_affinity = false;
+        return false;
+#endif
+    }
+    if (t->joined) return false;
+    int os_tid;
+    if (!_thread_attr_wait_applied(t, &os_tid)) {
+        return true;  /* the starting thread applies the new mask */
+    }
+#ifdef _WIN32
+    return _thread_os_set_affinity(t, t->handle);
+#else
+    return _thread_os_set_affinity(t, t->thread_id);
+#endif
+}
+
+bool Thread_set_sched_policy(Thread* t, ThreadSchedPolicy policy, int priority) {
+    if (!t) return false;
+    if (policy != THREAD_SCHED_OTHER && policy != THREAD_SCHED_FIFO && policy != THREAD_SCHED_RR) {
+        return false;
+    }
+    t->sched_policy   = policy;
+    t->sched_priority = priority;
+    t->has_sched      = true;
 
-    /* free the trampoline data */
-    free(td);
+    if (!t->started) return true;  /* applied by the thread at start */
+    if (t->joined) return false;
+    int os_tid;
+    if (!_thread_attr_wait_applied(t, &os_tid)) {
+        return true;  /* the starting thread applies the new policy */
+    }
+#ifdef _WIN32
+    return _thread_os_set_sched(t, t->handle, os_tid);
+#else
+    return _thread_os_set_sched(t, t->thread_id, os_tid);
+#endif
 }
 
+/* ========== New functions required by thread_pool.c ========== */
+
 /*
  * thread_create(AdvThread* t, ...) => returns int
+ *
+ * The start_routine and its argument live in the AdvThread itself,
+ * so starting a thread allocates nothing besides the OS thread.
  */
 int thread_create(AdvThread* t, void *(*start_routine)(void*), void* arg) {
     if (!t || !start_routine) {
         return -1;
     }
-    /* Allocate a small block that holds the user function and its arg. */
-    ThreadTrampoline* td = (ThreadTrampoline*)malloc(sizeof(ThreadTrampoline));
-    if (!td) {
-        return -1;
-    }
-    td->start_routine = start_routine;
-    td->arg           = arg;
-
-    /* Instead of casting the function pointer, we set t->target
-       to our known-compatible function '_thread_routine_trampoline' (which returns void).
-       Then we set t->arg to the 'td' block.
-    */
-    Thread_init(t, _thread_routine_trampoline, td, NULL);
+    Thread_init(t, NULL, arg, NULL);
+    t->start_routine = start_routine;
 
-    /* Now start */
     Thread_start(t);
-    if (!t->started) {
-        free(td);
-        return -1;
-    }
-    return 0;
+    return t->started ? 0 : -1;
 }
 
 /*
@@ -223,3 +535,205 @@ int thread_join(AdvThread* t) {
     Thread_join(t);
     return 0;
 }
+
+int thread_join_result(AdvThread* t, void** result) {
+    if (!t) return -1;
+    int rc = thread_join(t);
+    if (result) {
+        *result = t->result;
+    }
+    return rc;
+}
+
+/* ========== Thread-local storage ========== */
+
+#ifdef _WIN32
+/*
+ * FLS callbacks only receive the stored value, so each thread stores a small
+ * cell that remembers the key's destructor next to the user value.
+ */
+typedef struct {
+    ThreadLocalDtor dtor;
+    void*           value;
+} ThreadLocalCell;
+
+static VOID WINAPI _thread_local_cell_release(PVOID p) {
+    ThreadLocalCell* cell = (ThreadLocalCell*)p;
+    if (!cell) return;
+    if (cell->dtor && cell->value) {
+        cell->dtor(cell->value);
+    }
+    free(cell);
+}
+
+bool ThreadLocal_init(ThreadLocal* tls, ThreadLocalDtor dtor) {
+    if (!tls) return false;
+    tls->index = FlsAlloc(_thread_local_cell_release);
+    tls->dtor  = dtor;
+    return tls->index != FLS_OUT_OF_INDEXES;
+}
+
+void ThreadLocal_destroy(ThreadLocal* tls) {
+    if (!tls) return;
+    FlsFree(tls->index);
+}
+
+void* ThreadLocal_get(const ThreadLocal* tls) {
+    if (!tls) return NULL;
+    ThreadLocalCell* cell = (ThreadLocalCell*)FlsGetValue(tls->index);
+    return cell ? cell->value : NULL;
+}
+
+bool ThreadLocal_set(ThreadLocal* tls, void* value) {
+    if (!tls) return false;
+    ThreadLocalCell* cell = (ThreadLocalCell*)FlsGetValue(tls->index);
+    if (!cell) {
+        if (!value) return true;
+        cell = (ThreadLocalCell*)malloc(sizeof(ThreadLocalCell));
+        if (!cell) return false;
+        cell->dtor = tls->dtor;
+        if (!FlsSetValue(tls->index, cell)) {
+            free(cell);
+            return false;
+        }
+    }
+    cell->value = value;
+    return true;
+}
+
+#else
+
+bool ThreadLocal_init(ThreadLocal* tls, ThreadLocalDtor dtor) {
+    if (!tls) return false;
+    return pthread_key_create(&tls->key, dtor) == 0;
+}
+
+void ThreadLocal_destroy(ThreadLocal* tls) {
+    if (!tls) return;
+    pthread_key_delete(tls->key);
+}
+
+void* ThreadLocal_get(const ThreadLocal* tls) {
+    if (!tls) return NULL;
+    return pthread_getspecific(tls->key);
+}
+
+bool ThreadLocal_set(ThreadLocal* tls, void* value) {
+    if (!tls) return false;
+    return pthread_setspecific(tls->key, value) == 0;
+}
+
+#endif
+
+/* ========== ShardedCounter ========== */
+
+#define COUNTER_CACHE_LINE 64
+
+/*
+ * One slot per thread. 'value' is only ever written by the owning thread,
+ * readers just load it, so no read-modify-write is needed.
+ * Slots are cache-line aligned so two threads never write the same line.
+ */
+typedef struct CounterSlot {
+    volatile long long  value;
+    struct CounterSlot* prev;
+    struct CounterSlot* next;
+    ShardedCounter*     owner;
+    void*               raw;   /* unaligned block returned by malloc */
+} CounterSlot;
+
+struct ShardedCounter {
+    ThreadLocal  key;      /* the calling thread's CounterSlot */
+    Mutex        lock;     /* protects 'slots' and 'retired' */
+    CounterSlot* slots;
+    long long    retired;  /* sum of the slots of threads that have exited */
+};
+
+/* Runs at thread exit: fold the slot into 'retired' and drop it. */
+static void _counter_slot_release(void* p) {
+    CounterSlot* slot = (CounterSlot*)p;
+    ShardedCounter* c = slot->owner;
+    Mutex_lock(&c->lock);
+    c->retired += slot->value;
+    if (slot->prev) slot->prev->next = slot->next;
+    else            c->slots = slot->next;
+    if (slot->next) slot->next->prev = slot->prev;
+    Mutex_unlock(&c->lock);
+    free(slot->raw);
+}
+
+static CounterSlot* _counter_slot_register(ShardedCounter* c) {
+    void* raw = malloc(sizeof(CounterSlot) + 2 * COUNTER_CACHE_LINE);
+    if (!raw) return NULL;
+    /* round up to the next line, and keep the line after the slot unused as well */
+    uintptr_t addr = ((uintptr_t)raw + COUNTER_CACHE_LINE - 1) & ~(uintptr_t)(COUNTER_CACHE_LINE - 1);
+    CounterSlot* slot = (CounterSlot*)addr;
+    slot->value = 0;
+    slot->owner = c;
+    slot->raw   = raw;
+    slot->prev  = NULL;
+
+    Mutex_lock(&c->lock);
+    slot->next = c->slots;
+    if (c->slots) c->slots->prev = slot;
+    c->slots = slot;
+    Mutex_unlock(&c->lock);
+
+    if (!ThreadLocal_set(&c->key, slot)) {
+        _counter_slot_release(slot);
+        return NULL;
+    }
+    return slot;
+}
+
+ShardedCounter* ShardedCounter_create(void) {
+    ShardedCounter* c = (ShardedCounter*)malloc(sizeof(ShardedCounter));
+    if (!c) return NULL;
+    if (!ThreadLocal_init(&c->key, _counter_slot_release)) {
+        free(c);
+        return NULL;
+    }
+    Mutex_init(&c->lock, 0);
+    c->slots   = NULL;
+    c->retired = 0;
+    return c;
+}
+
+void ShardedCounter_destroy(ShardedCounter* c) {
+    if (!c) return;
+    /* first the key (Windows may still run destructors here, which take the lock) */
+    ThreadLocal_destroy(&c->key);
+    CounterSlot* slot = c->slots;
+    while (slot) {
+        CounterSlot* next = slot->next;
+        free(slot->raw);
+        slot = next;
+    }
+    Mutex_destroy(&c->lock);
+    free(c);
+}
+
+void ShardedCounter_add(ShardedCounter* c, long long delta) {
+    if (!c) return;
+    CounterSlot* slot = (CounterSlot*)ThreadLocal_get(&c->key);
+    if (!slot) {
+        slot = _counter_slot_register(c);
+        if (!slot) return;
+    }
+    /* single writer: a relaxed load + store is enough, no lock prefix */
+    adv_atomic_store_llong(&slot->value,
+                           adv_atomic_load_llong(&slot->value, ADV_RELAXED) + delta,
+                           ADV_RELAXED);
+}
+
+long long ShardedCounter_read(ShardedCounter* c) {
+    if (!c) return 0;
+    Mutex_lock(&c->lock);
+    long long sum = c->retired;
+    const CounterSlot* slot;
+    for (slot = c->slots; slot; slot = slot->next) {
+        sum += adv_atomic_load_llong(&slot->value, ADV_RELAXED);
+    }
+    Mutex_unlock(&c->lock);
+    return sum;
+}
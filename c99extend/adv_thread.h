@@ -13,6 +13,7 @@
 #define ADV_THREAD_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef _WIN32
   #include <windows.h>
@@ -24,6 +25,20 @@
   #error "Unsupported platform for adv_thread!"
 #endif
 
+/* Highest CPU index (exclusive) that Thread_set_affinity can address */
+#define THREAD_MAX_CPUS 1024
+
+/*
+ * Scheduling policies for Thread_set_sched_policy.
+ * THREAD_SCHED_OTHER is the normal time-sharing policy (priority = nice value),
+ * FIFO / RR are the real-time policies (priority = real-time priority).
+ */
+typedef enum {
+    THREAD_SCHED_OTHER = 0,
+    THREAD_SCHED_FIFO  = 1,
+    THREAD_SCHED_RR    = 2
+} ThreadSchedPolicy;
+
 /*
  * Declaration of the Thread struct
  */
@@ -37,12 +52,29 @@ typedef struct Thread {
     bool       started;
     bool       joined;
     bool       killed;
-    bool       is_alive;
+    volatile int is_alive;   /* written by the thread itself: release store, acquire load */
     char       name[64];
 
     /* user-specified "target" function (like in the old adv_thread) */
     void     (*target)(void*);
     void*      arg;
+
+    /* thread_create entry point and its return value (no heap trampoline needed) */
+    void*    (*start_routine)(void*);
+    void*      result;
+
+    /* OS-level attributes, applied by the thread itself when it starts */
+    bool               has_affinity;
+    unsigned long long affinity[THREAD_MAX_CPUS / 64]; /* bit i => CPU i */
+    bool               has_sched;
+    ThreadSchedPolicy  sched_policy;
+    int                sched_priority;
+    volatile int       os_tid;  /* kernel thread id on Linux, 0 until the thread runs */
+    volatile int       attr_state;  /* THREAD_ATTR_*: how far the thread got applying them */
+
+    /* cooperative cancellation (see Thread_request_stop) */
+    volatile int       stop_requested;
+    void* volatile     blocked_on;  /* futex word the thread sleeps on in Thread_block_on, or NULL */
 } Thread;
 
 /* Provide an alias: "AdvThread" is the same as "Thread" */
@@ -56,11 +88,48 @@ void Thread_init(Thread* t, void (*target)(void*), void* arg, const char* name);
 void Thread_start(Thread* t);
 void Thread_run(Thread* t);
 void Thread_join(Thread* t);   /* returns void in old style */
+
+/*
+ * Thread_kill no longer terminates the thread by force (on POSIX that sent
+ * SIGKILL, which takes down the whole process). It is now the same as
+ * Thread_request_stop: the thread exits when its code next checks for a stop.
+ */
 void Thread_kill(Thread* t);
 bool Thread_is_alive(Thread* t);
 void Thread_set_name(Thread* t, const char* name);
 const char* Thread_get_name(Thread* t);
 
+/*
+ * Note: the name is also handed to the OS when the thread starts
+ * (pthread_setname_np / SetThreadDescription), so it shows up in top, perf, gdb, ...
+ * Linux truncates it to 15 characters.
+ */
+
+/*
+ * Pin the thread to the given CPUs ('cpus' holds 'ncpus' CPU indexes,
+ * each < THREAD_MAX_CPUS). 'ncpus' == 0 removes the pinning.
+ * Before Thread_start, the setting is stored and applied when the thread starts;
+ * on a running thread, it is applied immediately.
+ *
+ * Returns false if the platform has no thread affinity (macOS, BSD),
+ * a CPU index is out of range, or the OS call fails.
+ * On Windows, only the first 64 CPUs (processor group 0) are addressable.
+ */
+bool Thread_set_affinity(Thread* t, const int* cpus, size_t ncpus);
+
+/*
+ * Set the scheduling policy.
+ *   THREAD_SCHED_OTHER: 'priority' is a nice value (-20..19, lower = more CPU).
+ *   THREAD_SCHED_FIFO / THREAD_SCHED_RR: 'priority' is the real-time priority (1..99 on Linux),
+ *   which usually needs CAP_SYS_NICE / root.
+ * Like Thread_set_affinity, it is deferred until Thread_start if the thread is not running yet;
+ * a deferred setting that the OS refuses at start is dropped and the thread runs with defaults.
+ * On Windows the policy is approximated with SetThreadPriority levels.
+ *
+ * Returns false if the OS refused (running thread) or the setting is unsupported.
+ */
+bool Thread_set_sched_policy(Thread* t, ThreadSchedPolicy policy, int priority);
+
 /*
  * New API for code that expects "thread_create" returning int, "thread_join" returning int
  * plus using "AdvThread" type.
@@ -70,4 +139,119 @@ const char* Thread_get_name(Thread* t);
 int thread_create(AdvThread* t, void *(*start_routine)(void*), void* arg);
 int thread_join(AdvThread* t);
 
+/*
+ * Like thread_join, and stores the value returned by start_routine in '*result'
+ * (if 'result' is not NULL).
+ */
+int thread_join_result(AdvThread* t, void** result);
+
+/*
+ * The value returned by the thread_create start_routine, once the thread has
+ * finished (NULL before that, or for threads started with a 'target').
+ */
+void* Thread_get_result(const Thread* t);
+
+/*
+ * ---------------------------------------------------------
+ * Cooperative cancellation
+ * ---------------------------------------------------------
+ * Thread_request_stop sets the thread's stop flag and wakes it if it is
+ * sleeping in an interruptible wait: Thread_sleep_interruptible,
+ * Semaphore_wait_interruptible, queue_pop, or anything built on Thread_block_on.
+ * The thread's own code decides where to exit, by polling Thread_should_stop()
+ * or by noticing that an interruptible call returned early. Process state is untouched.
+ */
+void    Thread_request_stop(Thread* t);
+bool    Thread_stop_requested(const Thread* t);
+
+/*
+ * The Thread object of the calling thread, or NULL if the calling thread
+ * was not started through Thread_start / thread_create (e.g. main).
+ */
+Thread* Thread_current(void);
+
+/* Shorthand for Thread_stop_requested(Thread_current()); false outside a Thread. */
+bool    Thread_should_stop(void);
+
+/*
+ * Sleeps for 'timeout_ns' nanoseconds, or less if a stop is requested.
+ * Returns true if it slept the full time, false if it was cut short by a stop request.
+ * A timeout above LLONG_MAX / 2 sleeps until a stop is requested (forever outside a Thread).
+ */
+bool    Thread_sleep_interruptible(unsigned long long timeout_ns);
+
+/* Gives up the rest of the time slice (sched_yield / SwitchToThread). */
+void    Thread_yield(void);
+
+/*
+ * Building block for interruptible blocking calls: like adv_futex_wait
+ * ('timeout_ns' < 0 => forever), but a stop request for the calling Thread
+ * also wakes it. Returns false on timeout. Callers re-check both their own
+ * condition and Thread_should_stop() afterwards.
+ */
+bool    Thread_block_on(volatile int* addr, int expected, long long timeout_ns);
+
+/*
+ * ---------------------------------------------------------
+ * Thread-local storage
+ * ---------------------------------------------------------
+ * ADV_THREAD_LOCAL is the compiler's storage class for static thread-local
+ * variables (fastest, but no destructor):
+ *
+ *     static ADV_THREAD_LOCAL int my_counter;
+ *
+ * ThreadLocal is a dynamic key (pthread_key_t / Windows FLS) whose per-thread
+ * value is passed to 'dtor' when the thread exits, if the value is non-NULL.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+  #define ADV_THREAD_LOCAL __declspec(thread)
+#else
+  #define ADV_THREAD_LOCAL __thread
+#endif
+
+typedef void (*ThreadLocalDtor)(void* value);
+
+typedef struct ThreadLocal {
+#ifdef _WIN32
+    DWORD           index;  /* FLS slot holding a small {dtor, value} cell */
+    ThreadLocalDtor dtor;
+#else
+    pthread_key_t   key;
+#endif
+} ThreadLocal;
+
+/*
+ * Creates a key. 'dtor' may be NULL. Returns true on success.
+ */
+bool  ThreadLocal_init(ThreadLocal* tls, ThreadLocalDtor dtor);
+
+/*
+ * Deletes the key. On POSIX, destructors are NOT run for values still set in
+ * other threads, so release those first if they own memory (Windows' FlsFree
+ * does run them).
+ */
+void  ThreadLocal_destroy(ThreadLocal* tls);
+
+/* Value for the calling thread (NULL if never set). */
+void* ThreadLocal_get(const ThreadLocal* tls);
+bool  ThreadLocal_set(ThreadLocal* tls, void* value);
+
+/*
+ * ---------------------------------------------------------
+ * ShardedCounter
+ * ---------------------------------------------------------
+ * A counter where each thread adds into its own cache-line sized slot
+ * (plain load + store, no atomic read-modify-write, no sharing), and reads
+ * sum all slots. When a thread exits, its slot is folded into the total.
+ * Meant for hot statistics counters: writes are cheap, reads are O(threads).
+ */
+typedef struct ShardedCounter ShardedCounter;
+
+ShardedCounter* ShardedCounter_create(void);
+
+/* No thread may still be adding to the counter. */
+void            ShardedCounter_destroy(ShardedCounter* c);
+void            ShardedCounter_add(ShardedCounter* c, long long delta);
+long long       ShardedCounter_read(ShardedCounter* c);
+
 #endif // ADV_THREAD_H
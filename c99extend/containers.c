@@ -4,6 +4,7 @@
  * Implementation of:
  *  - DynArray (dynamic array)
  *  - HashTable (string -> void* map)
+ *  - ConcurrentHashTable (thread-safe, sharded string -> void* map)
  *  - RBTree (int -> void* map)
  *  - HashSet (set of strings)
  * plus higher-order functions (map/filter/reduce) for DynArray.
@@ -12,10 +13,23 @@
  */
 
 #include "containers.h"
-#include "string_utils.h"
+#include "adv_atomic.h"
+#include "adv_mutex.h"
+#include "adv_semaphore.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+#endif
 
 /* =========================================================
  *             1) DYNAMIC ARRAY
@@ -108,121 +122,977 @@ void* da_reduce(const DynArray* arr, void* init, ReduceFn fn) {
  *             2) HASH TABLE (string -> void*)
  * ========================================================= */
 
-/* We'll do open addressing with linear probing. */
+/*
+ * Open addressing with linear probing, Swiss-table style:
+ * a separate control byte per slot holds either a state (EMPTY / MOVED) or,
+ * for a full slot, a 7-bit fragment of the key's hash. Probing reads the
+ * control bytes of HT_GROUP_WIDTH consecutive slots at once and compares
+ * them all against the fragment with one SIMD instruction (SSE2 / NEON,
+ * plain loop elsewhere), so full keys are only compared on a tag match.
+ *
+ * The control array has HT_GROUP_WIDTH - 1 extra bytes at the end that
+ * mirror the first ones, so a group starting near the end can be loaded
+ * with a single unaligned read.
+ */
+#define HT_GROUP_WIDTH 16
+
+#define HT_CTRL_EMPTY  0x80  /* never used: ends a probe chain */
+#define HT_CTRL_MOVED  0xFE  /* old table only: entry migrated or removed, keep probing */
+/* full slots hold the 7-bit tag (0x00..0x7F): high bit clear */
+
+/*
+ * The low 32 bits of the hash and the key length are cached in the slot
+ * (the top 7 bits are the tag in the control byte): a probe compares them
+ * before touching the key bytes, and moving an entry (rehash, backward shift)
+ * never has to rehash or strlen the key. Since the home slot comes from the
+ * cached bits, a table has at most 2^32 slots.
+ *
+ * Keys shorter than HT_INLINE_KEY bytes are stored in the slot itself (so a
+ * hit reads no other cache line); longer ones are copied into the table's
+ * key arena and the slot points there. Neither costs a malloc per entry.
+ */
+#define HT_INLINE_KEY 16  /* room for 15 bytes + '\0' */
+
 typedef struct {
-    char* key;
-    void* value;
-    bool  in_use;
-} HTSlot;
+    union {
+        char  inl[HT_INLINE_KEY];  /* len < HT_INLINE_KEY */
+        char* ptr;                 /* otherwise: into the key arena */
+    } key;
+    uint32_t len;    /* key length without the '\0' */
+    uint32_t hash;   /* low 32 bits of the key's hash */
+    void*    value;
+} HTSlot;  /* 32 bytes on 64-bit targets */
+
+#define HT_MAX_KEY_LEN ((size_t)0xFFFFFFFFu)
+
+/* A power-of-two capacity may double: stays within 2^32 slots and addressable memory */
+static inline bool _ht_can_double(size_t cap) {
+    return cap <= (size_t)0x7FFFFFFFu && cap <= ((size_t)-1 >> 2) / sizeof(HTSlot);
+}
+
+static inline const char* _ht_slot_key(const HTSlot* s) {
+    return s->len < HT_INLINE_KEY ? s->key.inl : s->key.ptr;
+}
+
+/*
+ * Key arena: long keys are bump-allocated from large chunks owned by the
+ * table and all released at once by ht_destroy. Removing a key only counts
+ * its bytes as dead; once dead bytes outweigh live ones the arena is
+ * compacted (live keys copied into one fresh chunk).
+ */
+#define HT_ARENA_CHUNK ((size_t)64 * 1024)
+
+typedef struct HTArenaChunk {
+    struct HTArenaChunk* next;
+    size_t size;   /* bytes in data[] */
+    size_t used;
+    char   data[];
+} HTArenaChunk;
+
+typedef struct {
+    HTArenaChunk* head;   /* chunk being filled */
+    size_t        total;  /* bytes in all chunks' data[] */
+    size_t        used;   /* bytes handed out */
+    size_t        dead;   /* of 'used': keys that were removed since */
+} HTArena;
+
+/* One slot array with its control bytes (a single allocation) */
+typedef struct {
+    HTSlot*        slots;
+    unsigned char* ctrl;
+    size_t         capacity;  /* >= HT_GROUP_WIDTH */
+} HTArray;
+
+/* Grow once count / capacity would exceed HT_MAX_LOAD_NUM / HT_MAX_LOAD_DEN */
+#define HT_MAX_LOAD_NUM 3
+#define HT_MAX_LOAD_DEN 4
+
+/* Old slots moved into the new table by each insert/remove while rehashing */
+#define HT_MIGRATE_STEP 16
 
 struct HashTable {
-    HTSlot* slots;
-    size_t  capacity;
-    size_t  count;
+    HTArray cur;
+    size_t  count;         /* entries in both tables */
+
+    /*
+     * Incremental rehashing: after a grow, entries still living in the
+     * previous table are moved over HT_MIGRATE_STEP slots at a time by the
+     * following inserts/removes, so no single call pays for the whole copy.
+     * Lookups check the new table first, then the old one.
+     */
+    HTArray old;           /* old.slots == NULL when not rehashing */
+    size_t  old_count;     /* entries not migrated yet */
+    size_t  migrate_pos;   /* next old slot to migrate */
+
+    uint64_t seed;         /* random, per table */
+    HTArena  arena;        /* keys of HT_INLINE_KEY bytes or more */
+};
+
+/* ---------- hashing ---------- */
+
+/*
+ * wyhash (public domain, Wang Yi), final version 4 without the optional
+ * condom mode. Reads the key 8 bytes at a time; short keys are covered by
+ * two overlapping reads instead of a byte loop.
+ */
+static const uint64_t _wyp[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
 };
 
-/* a basic string hash, e.g. djb2 */
-static unsigned long _strhash(const char* s) {
-    unsigned long h = 5381;
-    int c;
-    while ((c = *s++)) {
-        h = ((h << 5) + h) + c; /* h * 33 + c */
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 _ht_u128;
+#endif
+
+/* 64x64 -> 128 multiply: low half into *a, high half into *b */
+static inline void _wymum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+    _ht_u128 r = (_ht_u128)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), lo, hi;
+    uint64_t c = t < rl;
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+static inline uint64_t _wymix(uint64_t a, uint64_t b) {
+    _wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t _wyr8(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t _wyr4(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/* 1..3 bytes */
+static inline uint64_t _wyr3(const unsigned char* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t ht_hash(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t a, b;
+    seed ^= _wymix(seed ^ _wyp[0], _wyp[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (_wyr4(p) << 32) | _wyr4(p + off);
+            b = (_wyr4(p + len - 4) << 32) | _wyr4(p + len - 4 - off);
+        } else if (len > 0) {
+            a = _wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = _wymix(_wyr8(p) ^ _wyp[1], _wyr8(p + 8) ^ seed);
+                see1 = _wymix(_wyr8(p + 16) ^ _wyp[2], _wyr8(p + 24) ^ see1);
+                see2 = _wymix(_wyr8(p + 32) ^ _wyp[3], _wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = _wymix(_wyr8(p) ^ _wyp[1], _wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = _wyr8(p + i - 16);
+        b = _wyr8(p + i - 8);
+    }
+    a ^= _wyp[1];
+    b ^= seed;
+    _wymum(&a, &b);
+    return _wymix(a ^ _wyp[0] ^ len, b ^ _wyp[1]);
+}
+
+/*
+ * Per-table seed. Not cryptographic: it only has to differ between tables
+ * and runs so an attacker cannot prepare colliding keys in advance. Mixes the
+ * clock, a counter and addresses (randomized by ASLR).
+ */
+static uint64_t _ht_random_seed(const void* table) {
+    static volatile size_t counter = 0;
+    uint64_t s = (uint64_t)time(NULL);
+    s = _wymix(s ^ _wyp[0], (uint64_t)clock() ^ _wyp[1]);
+    s = _wymix(s ^ (uint64_t)(uintptr_t)table, (uint64_t)(uintptr_t)&counter ^ _wyp[2]);
+    s = _wymix(s ^ (uint64_t)(uintptr_t)&s,
+               (uint64_t)adv_atomic_fetch_add_size(&counter, 1, ADV_RELAXED) ^ _wyp[3]);
+    return s;
+}
+
+/*
+ * Capacities are powers of two: the low bits of the hash pick the home slot,
+ * the top 7 bits are the tag, so the two are independent.
+ */
+#define HT_TAG(h)        ((unsigned char)((h) >> 57))
+#define HT_HOME(h, cap)  ((size_t)(h) & ((cap) - 1))
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define HT_PREFETCH(p) __builtin_prefetch((p))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #define HT_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+  #define HT_PREFETCH(p) ((void)(p))
+#endif
+
+/* ---------- group matching ---------- */
+
+typedef unsigned int HTMask;  /* bit i <=> slot (group start + i) */
+
+static inline unsigned _ht_ctz(HTMask m) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(m);
+#endif
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+static inline HTMask _ht_match_byte(const unsigned char* g, unsigned char b) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)(const void*)g);
+    return (HTMask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)b)));
+}
+
+/* EMPTY or MOVED: the only control values with the high bit set */
+static inline HTMask _ht_match_free(const unsigned char* g) {
+    return (HTMask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(const void*)g));
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+static inline HTMask _ht_neon_mask(uint8x16_t eq) {
+    static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t m = vandq_u8(eq, vld1q_u8(bits));
+    return (HTMask)vaddv_u8(vget_low_u8(m)) | ((HTMask)vaddv_u8(vget_high_u8(m)) << 8);
+}
+
+static inline HTMask _ht_match_byte(const unsigned char* g, unsigned char b) {
+    return _ht_neon_mask(vceqq_u8(vld1q_u8(g), vdupq_n_u8(b)));
+}
+
+static inline HTMask _ht_match_free(const unsigned char* g) {
+    return _ht_neon_mask(vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(g)), vdupq_n_s8(0)));
+}
+
+#else
+
+static inline HTMask _ht_match_byte(const unsigned char* g, unsigned char b) {
+    HTMask m = 0;
+    int i;
+    for (i = 0; i < HT_GROUP_WIDTH; i++) {
+        m |= (HTMask)(g[i] == b) << i;
+    }
+    return m;
+}
+
+static inline HTMask _ht_match_free(const unsigned char* g) {
+    HTMask m = 0;
+    int i;
+    for (i = 0; i < HT_GROUP_WIDTH; i++) {
+        m |= (HTMask)(g[i] >> 7) << i;
+    }
+    return m;
+}
+
+#endif
+
+/* ---------- slot arrays ---------- */
+
+static bool _ht_array_init(HTArray* a, size_t capacity) {
+    size_t ctrl_bytes = capacity + HT_GROUP_WIDTH - 1;
+    void* mem = malloc(capacity * sizeof(HTSlot) + ctrl_bytes);
+    if (!mem) return false;
+    a->slots = (HTSlot*)mem;
+    a->ctrl = (unsigned char*)(a->slots + capacity);
+    a->capacity = capacity;
+    memset(a->ctrl, HT_CTRL_EMPTY, ctrl_bytes);
+    return true;
+}
+
+/* Writes a control byte, and its mirror if it is one of the first HT_GROUP_WIDTH - 1 */
+static inline void _ht_set_ctrl(HTArray* a, size_t i, unsigned char c) {
+    a->ctrl[i] = c;
+    if (i < HT_GROUP_WIDTH - 1) {
+        a->ctrl[a->capacity + i] = c;
+    }
+}
+
+/* Finds 'key' (of 'len' bytes) in one slot array; returns its index or (size_t)-1. */
+static size_t _ht_find_slot(const HTArray* a, const char* key, size_t len, uint64_t h) {
+    unsigned char tag = HT_TAG(h);
+    size_t mask = a->capacity - 1;
+    size_t pos = HT_HOME(h, a->capacity);
+    size_t scanned;
+    for (scanned = 0; scanned < a->capacity; scanned += HT_GROUP_WIDTH) {
+        const unsigned char* g = a->ctrl + pos;
+        HTMask match = _ht_match_byte(g, tag);
+        HTMask empty = _ht_match_byte(g, HT_CTRL_EMPTY);
+        if (empty) {
+            match &= (empty & (0u - empty)) - 1; /* the chain ends at the first EMPTY */
+        }
+        while (match) {
+            size_t idx = (pos + _ht_ctz(match)) & mask;
+            const HTSlot* s = &a->slots[idx];
+            if (s->hash == (uint32_t)h && s->len == len && memcmp(_ht_slot_key(s), key, len) == 0) {
+                return idx;
+            }
+            match &= match - 1;
+        }
+        if (empty) {
+            return (size_t)-1;
+        }
+        pos = (pos + HT_GROUP_WIDTH) & mask;
+    }
+    return (size_t)-1;
+}
+
+/* Places an entry known not to be present; the array must have a free slot. */
+static void _ht_place(HTArray* a, const HTSlot* entry, unsigned char tag) {
+    size_t mask = a->capacity - 1;
+    size_t pos = HT_HOME(entry->hash, a->capacity);
+    for (;;) {
+        HTMask free_slots = _ht_match_free(a->ctrl + pos);
+        if (free_slots) {
+            size_t idx = (pos + _ht_ctz(free_slots)) & mask;
+            a->slots[idx] = *entry;
+            _ht_set_ctrl(a, idx, tag);
+            return;
+        }
+        pos = (pos + HT_GROUP_WIDTH) & mask;
+    }
+}
+
+/*
+ * Backward-shift deletion: empties slot 'hole' and pulls later entries of the
+ * probe chain back into it, so no chain ever contains a gap and the table
+ * needs no tombstones. An entry at 'i' may move into the hole only if the
+ * hole is not before its home slot (cyclically).
+ */
+static void _ht_erase_slot(HTArray* a, size_t hole) {
+    size_t mask = a->capacity - 1;
+    size_t i = (hole + 1) & mask;
+    while (a->ctrl[i] != HT_CTRL_EMPTY) {
+        size_t home = HT_HOME(a->slots[i].hash, a->capacity);
+        size_t dist_home = (i - home) & mask;
+        size_t dist_hole = (i - hole) & mask;
+        if (dist_hole <= dist_home) {
+            a->slots[hole] = a->slots[i];
+            _ht_set_ctrl(a, hole, a->ctrl[i]);
+            hole = i;
+        }
+        i = (i + 1) & mask;
+    }
+    _ht_set_ctrl(a, hole, HT_CTRL_EMPTY);
+}
+
+/* ---------- key arena ---------- */
+
+static HTArenaChunk* _ht_chunk_new(size_t size) {
+    HTArenaChunk* c = (HTArenaChunk*)malloc(sizeof(HTArenaChunk) + size);
+    if (!c) return NULL;
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+/* Copies 'len' bytes plus a '\0' into the arena; NULL if out of memory. */
+static char* _ht_arena_store(HTArena* ar, const char* key, size_t len) {
+    HTArenaChunk* c = ar->head;
+    if (!c || c->size - c->used < len + 1) {
+        size_t size = len + 1 > HT_ARENA_CHUNK ? len + 1 : HT_ARENA_CHUNK;
+        c = _ht_chunk_new(size);
+        if (!c) return NULL;
+        c->next = ar->head;
+        ar->head = c;
+        ar->total += size;
+    }
+    char* dst = c->data + c->used;
+    memcpy(dst, key, len);
+    dst[len] = '\0';
+    c->used += len + 1;
+    ar->used += len + 1;
+    return dst;
+}
+
+static void _ht_arena_free(HTArena* ar) {
+    HTArenaChunk* c = ar->head;
+    while (c) {
+        HTArenaChunk* next = c->next;
+        free(c);
+        c = next;
+    }
+    ar->head = NULL;
+    ar->total = ar->used = ar->dead = 0;
+}
+
+static void _ht_array_rekey(HTArray* a, HTArena* ar) {
+    size_t i;
+    for (i = 0; i < a->capacity; i++) {
+        HTSlot* s = &a->slots[i];
+        if (a->ctrl[i] < HT_CTRL_EMPTY && s->len >= HT_INLINE_KEY) {
+            /* cannot fail: the new chunk was sized for every live key */
+            s->key.ptr = _ht_arena_store(ar, s->key.ptr, s->len);
+        }
+    }
+}
+
+/* Copies the live long keys into a single new chunk and drops the old chunks. */
+static void _ht_arena_compact(HashTable* ht) {
+    size_t live = ht->arena.used - ht->arena.dead;
+    HTArena fresh = { NULL, 0, 0, 0 };
+    if (live > 0) {
+        fresh.head = _ht_chunk_new(live);
+        if (!fresh.head) return; /* keep the old arena: it is still valid */
+        fresh.total = live;
+    }
+    _ht_array_rekey(&ht->cur, &fresh);
+    if (ht->old.slots) {
+        _ht_array_rekey(&ht->old, &fresh);
+    }
+    _ht_arena_free(&ht->arena);
+    ht->arena = fresh;
+}
+
+/* A long key was removed: its arena bytes become dead. */
+static void _ht_arena_release(HashTable* ht, size_t len) {
+    if (len < HT_INLINE_KEY) return;
+    ht->arena.dead += len + 1;
+    if (ht->arena.dead > HT_ARENA_CHUNK && ht->arena.dead > ht->arena.used / 2) {
+        _ht_arena_compact(ht);
     }
-    return h;
+}
+
+/* Moves up to 'steps' old slots into the current table; frees the old table when drained. */
+static void _ht_migrate(HashTable* ht, size_t steps) {
+    while (ht->old.slots && steps--) {
+        if (ht->migrate_pos < ht->old.capacity) {
+            size_t i = ht->migrate_pos++;
+            if (ht->old.ctrl[i] < HT_CTRL_EMPTY) {
+                _ht_place(&ht->cur, &ht->old.slots[i], ht->old.ctrl[i]);
+                _ht_set_ctrl(&ht->old, i, HT_CTRL_MOVED);
+                ht->old_count--;
+            }
+        }
+        if (ht->migrate_pos >= ht->old.capacity || ht->old_count == 0) {
+            free(ht->old.slots);
+            ht->old.slots = NULL;
+            ht->old.ctrl = NULL;
+            ht->old.capacity = 0;
+            ht->old_count = 0;
+            ht->migrate_pos = 0;
+        }
+    }
+}
+
+/* Starts an incremental rehash into a table twice as large. */
+static bool _ht_grow(HashTable* ht) {
+    /* a previous rehash still running: finish it first */
+    _ht_migrate(ht, (size_t)-1);
+    HTArray bigger;
+    if (!_ht_can_double(ht->cur.capacity)) return false;
+    if (!_ht_array_init(&bigger, ht->cur.capacity * 2)) return false;
+    ht->old = ht->cur;
+    ht->old_count = ht->count;
+    ht->migrate_pos = 0;
+    ht->cur = bigger;
+    return true;
 }
 
 HashTable* ht_create(size_t capacity) {
-    if (capacity < 4) capacity = 4;
+    size_t cap = HT_GROUP_WIDTH;
+    while (cap < capacity) {
+        if (!_ht_can_double(cap)) return NULL;
+        cap <<= 1;
+    }
     HashTable* ht = (HashTable*)malloc(sizeof(HashTable));
     if (!ht) return NULL;
-    ht->slots = (HTSlot*)calloc(capacity, sizeof(HTSlot));
-    if (!ht->slots) {
+    if (!_ht_array_init(&ht->cur, cap)) {
         free(ht);
         return NULL;
     }
-    ht->capacity = capacity;
     ht->count = 0;
+    ht->old.slots = NULL;
+    ht->old.ctrl = NULL;
+    ht->old.capacity = 0;
+    ht->old_count = 0;
+    ht->migrate_pos = 0;
+    ht->seed = _ht_random_seed(ht);
+    ht->arena.head = NULL;
+    ht->arena.total = ht->arena.used = ht->arena.dead = 0;
     return ht;
 }
 
-bool ht_insert(HashTable* ht, const char* key, void* value) {
-    if (!ht || !key) return false;
-    if (ht->count >= ht->capacity / 2) {
-        /* maybe resize? for simplicity, skip or partial approach */
+/*
+ * The _h helpers take the key's hash (under ht->seed) precomputed, so callers
+ * that already hashed the key (ConcurrentHashTable picks the shard with it)
+ * do not hash it twice.
+ */
+static bool _ht_insert_h(HashTable* ht, const char* key, size_t len, uint64_t h, void* value) {
+    _ht_migrate(ht, HT_MIGRATE_STEP);
+
+    /* update in place, wherever the key currently lives */
+    size_t pos = _ht_find_slot(&ht->cur, key, len, h);
+    if (pos != (size_t)-1) {
+        ht->cur.slots[pos].value = value;
+        return true;
     }
-    unsigned long h = _strhash(key);
-    size_t idx = (size_t)(h % ht->capacity);
-    size_t i;
-    for (i = 0; i < ht->capacity; i++) {
-        size_t probe = (idx + i) % ht->capacity;
-        if (!ht->slots[probe].in_use) {
-            /* insert */
-            char* dup = adv_strdup(key);
-            if (!dup) return false;
-            ht->slots[probe].key = dup;
-            ht->slots[probe].value = value;
-            ht->slots[probe].in_use = true;
-            ht->count++;
-            return true;
-        } else if (strcmp(ht->slots[probe].key, key) == 0) {
-            /* update */
-            ht->slots[probe].value = value;
+    if (ht->old.slots && ht->old_count > 0) {
+        pos = _ht_find_slot(&ht->old, key, len, h);
+        if (pos != (size_t)-1) {
+            ht->old.slots[pos].value = value;
             return true;
         }
     }
-    return false;
+
+    /* new key: grow first if it would push the load factor over the limit */
+    /* (entries still in the old table count too: they are all headed for this one) */
+    if ((ht->count + 1) * HT_MAX_LOAD_DEN > ht->cur.capacity * HT_MAX_LOAD_NUM) {
+        if (!_ht_grow(ht) && ht->count + 1 >= ht->cur.capacity) {
+            return false; /* out of memory, and we keep one slot empty so probes terminate */
+        }
+    }
+    /* the stored copy is always NUL-terminated, even for a slice of a larger buffer */
+    HTSlot entry;
+    if (len < HT_INLINE_KEY) {
+        memset(entry.key.inl, 0, HT_INLINE_KEY);
+        memcpy(entry.key.inl, key, len);
+    } else {
+        entry.key.ptr = _ht_arena_store(&ht->arena, key, len);
+        if (!entry.key.ptr) return false;
+    }
+    entry.len = (uint32_t)len;
+    entry.hash = (uint32_t)h;
+    entry.value = value;
+    _ht_place(&ht->cur, &entry, HT_TAG(h));
+    ht->count++;
+    return true;
 }
 
-void* ht_get(const HashTable* ht, const char* key) {
-    if (!ht || !key) return NULL;
-    unsigned long h = _strhash(key);
-    size_t idx = (size_t)(h % ht->capacity);
-    size_t i;
-    for (i = 0; i < ht->capacity; i++) {
-        size_t probe = (idx + i) % ht->capacity;
-        if (!ht->slots[probe].in_use) {
-            return NULL;
+static void* _ht_get_h(const HashTable* ht, const char* key, size_t len, uint64_t h) {
+    size_t pos = _ht_find_slot(&ht->cur, key, len, h);
+    if (pos != (size_t)-1) {
+        return ht->cur.slots[pos].value;
+    }
+    if (ht->old.slots && ht->old_count > 0) {
+        pos = _ht_find_slot(&ht->old, key, len, h);
+        if (pos != (size_t)-1) {
+            return ht->old.slots[pos].value;
         }
-        if (ht->slots[probe].key && strcmp(ht->slots[probe].key, key) == 0) {
-            return ht->slots[probe].value;
+    }
+    return NULL;
+}
+
+static void* _ht_remove_h(HashTable* ht, const char* key, size_t len, uint64_t h) {
+    _ht_migrate(ht, HT_MIGRATE_STEP);
+    size_t pos = _ht_find_slot(&ht->cur, key, len, h);
+    if (pos != (size_t)-1) {
+        void* val = ht->cur.slots[pos].value;
+        _ht_erase_slot(&ht->cur, pos);
+        ht->count--;
+        _ht_arena_release(ht, len);
+        return val;
+    }
+    if (ht->old.slots && ht->old_count > 0) {
+        pos = _ht_find_slot(&ht->old, key, len, h);
+        if (pos != (size_t)-1) {
+            void* val = ht->old.slots[pos].value;
+            /* the old table is being drained anyway: a marker is cheaper than shifting */
+            _ht_set_ctrl(&ht->old, pos, HT_CTRL_MOVED);
+            ht->old_count--;
+            ht->count--;
+            _ht_arena_release(ht, len);
+            return val;
         }
     }
     return NULL;
 }
 
+bool ht_insert(HashTable* ht, const char* key, void* value) {
+    if (!key) return false;
+    return ht_insert_n(ht, key, strlen(key), value);
+}
+
+bool ht_insert_n(HashTable* ht, const char* key, size_t len, void* value) {
+    if (!ht || !key || len > HT_MAX_KEY_LEN) return false;
+    return _ht_insert_h(ht, key, len, ht_hash(key, len, ht->seed), value);
+}
+
+void* ht_get(const HashTable* ht, const char* key) {
+    if (!key) return NULL;
+    return ht_get_n(ht, key, strlen(key));
+}
+
+void* ht_get_n(const HashTable* ht, const char* key, size_t len) {
+    if (!ht || !key || len > HT_MAX_KEY_LEN) return NULL;
+    return _ht_get_h(ht, key, len, ht_hash(key, len, ht->seed));
+}
+
 void* ht_remove(HashTable* ht, const char* key) {
-    if (!ht || !key) return NULL;
-    unsigned long h = _strhash(key);
-    size_t idx = (size_t)(h % ht->capacity);
+    if (!key) return NULL;
+    return ht_remove_n(ht, key, strlen(key));
+}
+
+void* ht_remove_n(HashTable* ht, const char* key, size_t len) {
+    if (!ht || !key || len > HT_MAX_KEY_LEN) return NULL;
+    return _ht_remove_h(ht, key, len, ht_hash(key, len, ht->seed));
+}
+
+bool ht_reserve(HashTable* ht, size_t n) {
+    if (!ht) return false;
+    if (n > (size_t)-1 / HT_MAX_LOAD_DEN) return false;
+    /* an explicit reserve pays for the whole move at once: finish any rehash too */
+    _ht_migrate(ht, (size_t)-1);
+    size_t cap = ht->cur.capacity;
+    while (n * HT_MAX_LOAD_DEN > cap * HT_MAX_LOAD_NUM) {
+        if (!_ht_can_double(cap)) return false;
+        cap <<= 1;
+    }
+    if (cap == ht->cur.capacity) return true;
+
+    HTArray bigger;
+    if (!_ht_array_init(&bigger, cap)) return false;
     size_t i;
-    for (i = 0; i < ht->capacity; i++) {
-        size_t probe = (idx + i) % ht->capacity;
-        if (!ht->slots[probe].in_use) {
-            return NULL;
+    for (i = 0; i < ht->cur.capacity; i++) {
+        if (ht->cur.ctrl[i] < HT_CTRL_EMPTY) {
+            _ht_place(&bigger, &ht->cur.slots[i], ht->cur.ctrl[i]);
         }
-        if (ht->slots[probe].key && strcmp(ht->slots[probe].key, key) == 0) {
-            void* val = ht->slots[probe].value;
-            free(ht->slots[probe].key);
-            ht->slots[probe].key = NULL;
-            ht->slots[probe].value = NULL;
-            ht->slots[probe].in_use = false;
-            ht->count--;
-            return val;
+    }
+    free(ht->cur.slots);
+    ht->cur = bigger;
+    return true;
+}
+
+/* Keys hashed and prefetched ahead of use by ht_insert_bulk / ht_get_batch */
+#define HT_BULK_BATCH 16
+
+bool ht_insert_bulk(HashTable* ht, const char* const* keys, void* const* values, size_t n) {
+    if (!ht || (!keys && n > 0)) return false;
+    if (n > (size_t)-1 - ht->count || !ht_reserve(ht, ht->count + n)) return false;
+
+    /*
+     * With the room reserved no insert grows the table, so each batch is
+     * hashed first, the home groups are prefetched, and the inserts that
+     * follow find their control bytes and slots already on the way in.
+     */
+    uint64_t hashes[HT_BULK_BATCH];
+    size_t   lens[HT_BULK_BATCH];
+    size_t base, i;
+    bool bad_key = false;
+    for (base = 0; base < n && !bad_key; base += HT_BULK_BATCH) {
+        size_t batch = n - base < HT_BULK_BATCH ? n - base : HT_BULK_BATCH;
+        for (i = 0; i < batch; i++) {
+            const char* key = keys[base + i];
+            if (!key || (lens[i] = strlen(key)) > HT_MAX_KEY_LEN) {
+                /* insert the part of the batch before it, then stop */
+                bad_key = true;
+                batch = i;
+                break;
+            }
+            hashes[i] = ht_hash(key, lens[i], ht->seed);
+            size_t home = HT_HOME(hashes[i], ht->cur.capacity);
+            HT_PREFETCH(ht->cur.ctrl + home);
+            HT_PREFETCH(ht->cur.slots + home);
+        }
+        for (i = 0; i < batch; i++) {
+            void* value = values ? values[base + i] : NULL;
+            if (!_ht_insert_h(ht, keys[base + i], lens[i], hashes[i], value)) return false;
         }
     }
-    return NULL;
+    return !bad_key;
+}
+
+size_t ht_get_batch(const HashTable* ht, const char* const* keys, size_t n, void** out_values) {
+    if (!out_values) return 0;
+    if (!ht || !keys) {
+        size_t i;
+        for (i = 0; i < n; i++) out_values[i] = NULL;
+        return 0;
+    }
+    /*
+     * Hash a whole batch and issue the prefetches for every home group
+     * before resolving the first key: the cache misses of the batch are in
+     * flight together instead of one after another.
+     */
+    uint64_t hashes[HT_BULK_BATCH];
+    size_t   lens[HT_BULK_BATCH];
+    size_t base, i, found = 0;
+    for (base = 0; base < n; base += HT_BULK_BATCH) {
+        size_t batch = n - base < HT_BULK_BATCH ? n - base : HT_BULK_BATCH;
+        for (i = 0; i < batch; i++) {
+            const char* key = keys[base + i];
+            lens[i] = key ? strlen(key) : 0;
+            hashes[i] = key ? ht_hash(key, lens[i], ht->seed) : 0;
+            size_t home = HT_HOME(hashes[i], ht->cur.capacity);
+            HT_PREFETCH(ht->cur.ctrl + home);
+            HT_PREFETCH(ht->cur.slots + home);
+        }
+        for (i = 0; i < batch; i++) {
+            const char* key = keys[base + i];
+            void* v = NULL;
+            if (key && lens[i] <= HT_MAX_KEY_LEN) {
+                v = _ht_get_h(ht, key, lens[i], hashes[i]);
+            }
+            out_values[base + i] = v;
+            found += v != NULL;
+        }
+    }
+    return found;
+}
+
+void ht_iter_init(const HashTable* ht, HTIter* it) {
+    if (!it) return;
+    it->ht = ht;
+    it->pos = 0;
+}
+
+bool ht_iter_next(HTIter* it, const char** key, size_t* key_len, void** value) {
+    if (!it || !it->ht) return false;
+    const HashTable* ht = it->ht;
+    /* positions [0, cur.capacity) are the current table, the rest the old one */
+    while (it->pos < ht->cur.capacity + ht->old.capacity) {
+        size_t p = it->pos++;
+        const HTArray* a = &ht->cur;
+        if (p >= ht->cur.capacity) {
+            a = &ht->old;
+            p -= ht->cur.capacity;
+        }
+        if (a->ctrl[p] < HT_CTRL_EMPTY) {
+            const HTSlot* s = &a->slots[p];
+            if (key) *key = _ht_slot_key(s);
+            if (key_len) *key_len = s->len;
+            if (value) *value = s->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Probe length of every full slot: 1 + distance from its home slot */
+static void _ht_probe_stats(const HTArray* a, HTStats* st, size_t* total) {
+    size_t i;
+    st->memory_bytes += a->capacity * (sizeof(HTSlot) + 1) + HT_GROUP_WIDTH - 1;
+    for (i = 0; i < a->capacity; i++) {
+        if (a->ctrl[i] >= HT_CTRL_EMPTY) continue;
+        size_t home = HT_HOME(a->slots[i].hash, a->capacity);
+        size_t probe = ((i - home) & (a->capacity - 1)) + 1;
+        *total += probe;
+        if (probe > st->max_probe) st->max_probe = probe;
+    }
+}
+
+void ht_stats(const HashTable* ht, HTStats* st) {
+    if (!st) return;
+    memset(st, 0, sizeof(*st));
+    if (!ht) return;
+    size_t total = 0;
+    st->count = ht->count;
+    st->capacity = ht->cur.capacity;
+    st->load_factor = (double)(ht->count - ht->old_count) / (double)ht->cur.capacity;
+    st->rehashing = ht->old.slots != NULL;
+    st->pending_migration = ht->old_count;
+    st->memory_bytes = sizeof(HashTable) + ht->arena.total;
+    _ht_probe_stats(&ht->cur, st, &total);
+    if (ht->old.slots) {
+        _ht_probe_stats(&ht->old, st, &total);
+    }
+    st->avg_probe = ht->count ? (double)total / (double)ht->count : 0.0;
 }
 
 void ht_destroy(HashTable* ht) {
     if (!ht) return;
-    size_t i;
-    for (i = 0; i < ht->capacity; i++) {
-        if (ht->slots[i].in_use) {
-            free(ht->slots[i].key);
+    /* keys live in the slots or the arena: no per-entry frees */
+    free(ht->cur.slots);
+    free(ht->old.slots);
+    _ht_arena_free(&ht->arena);
+    free(ht);
+}
+
+/* =========================================================
+ *      2b) CONCURRENT HASH TABLE (string -> void*, thread-safe)
+ * ========================================================= */
+
+/*
+ * Lock striping: the table is split into a power-of-two number of shards,
+ * each an ordinary HashTable guarded by its own RWLock. A key is hashed once
+ * with the table-wide seed (shared by every shard); bits 32.. of the hash
+ * pick the shard, which are independent of the bits the shard uses (low 32
+ * for the home slot and the cached hash, top 7 for the tag).
+ *
+ * Each shard sits on its own cache line(s), so threads working on different
+ * shards never share a line; readers of one shard only share its lock word.
+ */
+#define CHT_CACHE_LINE     64
+#define CHT_DEFAULT_SHARDS 128
+#define CHT_MAX_SHARDS     65536  /* shard bits must stay below the tag bits */
+
+typedef struct {
+    RWLock     lock;
+    HashTable* ht;
+} CHTShardBody;
+
+typedef union {
+    CHTShardBody s;
+    char pad[(sizeof(CHTShardBody) + CHT_CACHE_LINE - 1) / CHT_CACHE_LINE * CHT_CACHE_LINE];
+} CHTShard;
+
+struct ConcurrentHashTable {
+    CHTShard* shards;      /* cache-line aligned, inside 'raw' */
+    void*     raw;         /* block returned by malloc */
+    size_t    shard_mask;  /* shards - 1 */
+    uint64_t  seed;
+};
+
+static inline CHTShard* _cht_shard(const ConcurrentHashTable* t, uint64_t h) {
+    return &t->shards[(size_t)(h >> 32) & t->shard_mask];
+}
+
+ConcurrentHashTable* cht_create(size_t capacity, size_t shards) {
+    size_t n = 1, i;
+    if (shards == 0) shards = CHT_DEFAULT_SHARDS;
+    if (shards > CHT_MAX_SHARDS) shards = CHT_MAX_SHARDS;
+    while (n < shards) n <<= 1;
+
+    ConcurrentHashTable* t = (ConcurrentHashTable*)malloc(sizeof(ConcurrentHashTable));
+    if (!t) return NULL;
+    t->raw = malloc(n * sizeof(CHTShard) + CHT_CACHE_LINE);
+    if (!t->raw) {
+        free(t);
+        return NULL;
+    }
+    uintptr_t addr = ((uintptr_t)t->raw + CHT_CACHE_LINE - 1) & ~(uintptr_t)(CHT_CACHE_LINE - 1);
+    t->shards = (CHTShard*)addr;
+    t->shard_mask = n - 1;
+    t->seed = _ht_random_seed(t);
+
+    for (i = 0; i < n; i++) {
+        CHTShard* sh = &t->shards[i];
+        sh->s.ht = ht_create(capacity / n);
+        if (!sh->s.ht || !RWLock_init(&sh->s.lock, MUTEX_DEFAULT_SPIN)) {
+            ht_destroy(sh->s.ht);
+            while (i-- > 0) {
+                RWLock_destroy(&t->shards[i].s.lock);
+                ht_destroy(t->shards[i].s.ht);
+            }
+            free(t->raw);
+            free(t);
+            return NULL;
         }
+        sh->s.ht->seed = t->seed;
     }
-    free(ht->slots);
-    free(ht);
+    return t;
+}
+
+void* cht_get(const ConcurrentHashTable* t, const char* key) {
+    if (!t || !key) return NULL;
+    size_t len = strlen(key);
+    if (len > HT_MAX_KEY_LEN) return NULL;
+    uint64_t h = ht_hash(key, len, t->seed);
+    CHTShard* sh = _cht_shard(t, h);
+    RWLock_read_lock(&sh->s.lock);
+    void* val = _ht_get_h(sh->s.ht, key, len, h);
+    RWLock_read_unlock(&sh->s.lock);
+    return val;
+}
+
+bool cht_insert_or_assign(ConcurrentHashTable* t, const char* key, void* value) {
+    if (!t || !key) return false;
+    size_t len = strlen(key);
+    if (len > HT_MAX_KEY_LEN) return false;
+    uint64_t h = ht_hash(key, len, t->seed);
+    CHTShard* sh = _cht_shard(t, h);
+    RWLock_write_lock(&sh->s.lock);
+    bool ok = _ht_insert_h(sh->s.ht, key, len, h, value);
+    RWLock_write_unlock(&sh->s.lock);
+    return ok;
+}
+
+void* cht_compute_if_absent(ConcurrentHashTable* t, const char* key,
+                            CHT_ComputeFn fn, void* userData) {
+    if (!t || !key || !fn) return NULL;
+    size_t len = strlen(key);
+    if (len > HT_MAX_KEY_LEN) return NULL;
+    uint64_t h = ht_hash(key, len, t->seed);
+    CHTShard* sh = _cht_shard(t, h);
+
+    /* the common case, key present, only needs the read lock */
+    RWLock_read_lock(&sh->s.lock);
+    void* val = _ht_get_h(sh->s.ht, key, len, h);
+    RWLock_read_unlock(&sh->s.lock);
+    if (val) return val;
+
+    RWLock_write_lock(&sh->s.lock);
+    val = _ht_get_h(sh->s.ht, key, len, h);  /* another thread may have won meanwhile */
+    if (!val) {
+        val = fn(key, userData);
+        if (val && !_ht_insert_h(sh->s.ht, key, len, h, val)) {
+            val = NULL;
+        }
+    }
+    RWLock_write_unlock(&sh->s.lock);
+    return val;
+}
+
+void* cht_remove(ConcurrentHashTable* t, const char* key) {
+    if (!t || !key) return NULL;
+    size_t len = strlen(key);
+    if (len > HT_MAX_KEY_LEN) return NULL;
+    uint64_t h = ht_hash(key, len, t->seed);
+    CHTShard* sh = _cht_shard(t, h);
+    RWLock_write_lock(&sh->s.lock);
+    void* val = _ht_remove_h(sh->s.ht, key, len, h);
+    RWLock_write_unlock(&sh->s.lock);
+    return val;
+}
+
+size_t cht_size(const ConcurrentHashTable* t) {
+    if (!t) return 0;
+    size_t i, total = 0;
+    for (i = 0; i <= t->shard_mask; i++) {
+        CHTShard* sh = &t->shards[i];
+        RWLock_read_lock(&sh->s.lock);
+        total += sh->s.ht->count;
+        RWLock_read_unlock(&sh->s.lock);
+    }
+    return total;
+}
+
+void cht_destroy(ConcurrentHashTable* t) {
+    if (!t) return;
+    size_t i;
+    for (i = 0; i <= t->shard_mask; i++) {
+        RWLock_destroy(&t->shards[i].s.lock);
+        ht_destroy(t->shards[i].s.ht);
+    }
+    free(t->raw);
+    free(t);
 }
 
 /* =========================================================
@@ -453,42 +1323,156 @@ void rbt_destroy(RBTree* tree) {
     free(tree);
 }
 
-
 /* =========================================================
  *             GENERIC HASHSET
  * ========================================================= */
 
-typedef enum {
-    SLOT_EMPTY = 0,  /* never used */
-    SLOT_FILLED = 1, /* in use */
-    SLOT_REMOVED= 2  /* was in use, then removed => tombstone */
-} SlotState;
-
 /*
- * Each slot holds:
- *   - data (void*)
- *   - state (empty, filled, removed)
- *   - cached hash
+ * Structure-of-arrays layout, one block per table. Each slot i has:
+ *   - meta[i]:   one byte: HS_META_EMPTY, HS_META_REMOVED (tombstone), or
+ *                HS_META_FULL | 7-bit tag of the hash
+ *   - hashes[i]: cached full hash
+ *   - data[i]:   the element
+ * A probe walks the dense meta bytes (64 slots per cache line) and reads
+ * hashes[] / data[] and calls eqFn only on a tag match, so a miss rarely
+ * leaves the meta array. 17 bytes per slot on 64-bit targets.
  */
-typedef struct {
-    void*     data;
-    SlotState state;
-    size_t    hash;
-} HS_Slot;
+#define HS_META_EMPTY   0x00  /* never used */
+#define HS_META_REMOVED 0x01  /* was in use, then removed => tombstone */
+#define HS_META_FULL    0x80  /* in use; low 7 bits hold the tag */
+
+#define HS_DEFAULT_LOAD_FACTOR 0.75f
 
 struct HashSet {
-    HS_Slot*  slots;
+    unsigned char* meta;
+    size_t*   hashes;
+    void**    data;      /* start of the block holding all three arrays */
     size_t    capacity;
-    size_t    size;      /* number of FILLED items */
+    size_t    size;      /* number of FULL slots */
+    size_t    tombstones;/* number of REMOVED slots */
     HS_HashFn hashFn;
     HS_EqFn   eqFn;
 
     float     maxLoadFactor; /* e.g. 0.75 */
+    HSProbing probing;
 };
 
 /* forward declarations */
 static bool hs_resize(HashSet* set, size_t newCap);
 
+/* Tag from all bits of the hash: user hashes often leave the high bits zero. */
+static inline unsigned char hs_tag(size_t h) {
+    return (unsigned char)(HS_META_FULL | (((uint64_t)h * 0x9E3779B97F4A7C15ULL) >> 57));
+}
+
+static inline size_t hs_next(const HashSet* set, size_t pos) {
+    return pos + 1 == set->capacity ? 0 : pos + 1;
+}
+
+static inline void hs_put(HashSet* set, size_t pos, void* elem, size_t h) {
+    set->meta[pos]   = hs_tag(h);
+    set->hashes[pos] = h;
+    set->data[pos]   = elem;
+}
+
+/*
+ * Allocates the arrays for 'cap' slots, all EMPTY. Leaves the set
+ * untouched on failure.
+ */
+static bool hs_alloc(HashSet* set, size_t cap) {
+    const size_t perSlot = sizeof(void*) + sizeof(size_t) + 1;
+    if (cap > (size_t)-1 / perSlot) {
+        return false;
+    }
+    void** block = (void**)calloc(cap, perSlot);
+    if (!block) {
+        return false;
+    }
+    set->data     = block;
+    set->hashes   = (size_t*)(void*)(block + cap);
+    set->meta     = (unsigned char*)(set->hashes + cap);
+    set->capacity = cap;
+    return true;
+}
+
+/* Linear probing: slot holding 'elem', or (size_t)-1. */
+static size_t hs_lp_find(const HashSet* set, const void* elem, size_t h) {
+    unsigned char tag = hs_tag(h);
+    size_t pos = h % set->capacity;
+    size_t i;
+    for (i = 0; i < set->capacity; i++) {
+        unsigned char m = set->meta[pos];
+        if (m == HS_META_EMPTY) {
+            /* can't be further in open addressing => not found */
+            return (size_t)-1;
+        }
+        if (m == tag && set->hashes[pos] == h && set->eqFn(set->data[pos], elem)) {
+            return pos;
+        }
+        /* tombstones and other elements: keep searching */
+        pos = hs_next(set, pos);
+    }
+    return (size_t)-1;
+}
+
+/*
+ * Robin Hood helpers. Only FULL and EMPTY slots exist in this mode; the
+ * displacement of an element is its distance from its home slot.
+ */
+static inline size_t hs_dist(const HashSet* set, size_t pos, size_t h) {
+    size_t home = h % set->capacity;
+    return pos >= home ? pos - home : pos + set->capacity - home;
+}
+
+/* Slot holding 'elem', or (size_t)-1. */
+static size_t hs_rh_find(const HashSet* set, const void* elem, size_t h) {
+    unsigned char tag = hs_tag(h);
+    size_t pos = h % set->capacity;
+    size_t d;
+    for (d = 0; d < set->capacity; d++) {
+        unsigned char m = set->meta[pos];
+        if (m == HS_META_EMPTY) {
+            return (size_t)-1;
+        }
+        if (m == tag && set->hashes[pos] == h && set->eqFn(set->data[pos], elem)) {
+            return pos;
+        }
+        /* an element closer to home than 'elem' would be: 'elem' is absent */
+        if (hs_dist(set, pos, set->hashes[pos]) < d) {
+            return (size_t)-1;
+        }
+        pos = hs_next(set, pos);
+    }
+    return (size_t)-1;
+}
+
+/*
+ * Places an element known to be absent: it takes the slot of the first
+ * element closer to its home than itself, which then continues the probe.
+ * Needs a free slot.
+ */
+static void hs_rh_place(HashSet* set, void* elem, size_t h) {
+    size_t pos = h % set->capacity;
+    size_t d = 0;
+    for (;;) {
+        if (set->meta[pos] == HS_META_EMPTY) {
+            hs_put(set, pos, elem, h);
+            return;
+        }
+        size_t sd = hs_dist(set, pos, set->hashes[pos]);
+        if (sd < d) {
+            void* tmpData = set->data[pos];
+            size_t tmpHash = set->hashes[pos];
+            hs_put(set, pos, elem, h);
+            elem = tmpData;
+            h = tmpHash;
+            d = sd;
+        }
+        pos = hs_next(set, pos);
+        d++;
+    }
+}
+
 /*
  * Creates a new HashSet with given capacity, hashFn, eqFn.
  */
@@ -496,100 +1480,138 @@ HashSet* hs_create(size_t initial_capacity,
                    HS_HashFn hashFn,
                    HS_EqFn   eqFn)
 {
+    return hs_create_ex(initial_capacity, hashFn, eqFn, HS_LINEAR_PROBING, 0.0f);
+}
+
+HashSet* hs_create_ex(size_t initial_capacity,
+                      HS_HashFn hashFn,
+                      HS_EqFn   eqFn,
+                      HSProbing probing,
+                      float     max_load_factor)
+{
+    if (probing != HS_LINEAR_PROBING && probing != HS_ROBIN_HOOD) {
+        return NULL;
+    }
+    if (max_load_factor == 0.0f) {
+        max_load_factor = HS_DEFAULT_LOAD_FACTOR;
+    }
+    if (!(max_load_factor >= HS_MIN_LOAD_FACTOR && max_load_factor <= HS_MAX_LOAD_FACTOR)) {
+        return NULL;
+    }
     if (initial_capacity < 4) {
         initial_capacity = 4;
     }
     HashSet* hs = (HashSet*)malloc(sizeof(HashSet));
     if (!hs) return NULL;
 
-    hs->slots = (HS_Slot*)calloc(initial_capacity, sizeof(HS_Slot));
-    if (!hs->slots) {
+    if (!hs_alloc(hs, initial_capacity)) {
         free(hs);
         return NULL;
     }
-    hs->capacity = initial_capacity;
     hs->size = 0;
+    hs->tombstones = 0;
     hs->hashFn = hashFn;
     hs->eqFn   = eqFn;
-    hs->maxLoadFactor = 0.75f; /* default load factor */
+    hs->maxLoadFactor = max_load_factor;
+    hs->probing = probing;
 
     return hs;
 }
 
+/* Slot holding 'elem' (whose hash is 'h'), or (size_t)-1. */
+static inline size_t hs_find(const HashSet* set, const void* elem, size_t h) {
+    return set->probing == HS_ROBIN_HOOD ? hs_rh_find(set, elem, h) : hs_lp_find(set, elem, h);
+}
+
 /*
- * Insert or do nothing if element is already in the set.
+ * Makes room for one more element: checks the load factor, counting
+ * tombstones, since they lengthen probes just like elements and a miss
+ * only stops at an EMPTY slot.
  */
-bool hs_insert(HashSet* set, void* elem) {
-    if (!set || !elem) return false;
-    /* check load factor */
-    float load = (float)set->size / (float)set->capacity;
-    if (load > set->maxLoadFactor) {
-        /* try to resize if possible */
-        size_t newCap = set->capacity * 2;
+static void hs_make_room(HashSet* set) {
+    if ((float)(set->size + set->tombstones + 1) > set->maxLoadFactor * (float)set->capacity) {
+        /*
+         * many tombstones => rehash at the same size (compaction): afterwards
+         * the set is below 2/3 of the limit, so compactions stay amortized O(1)
+         */
+        size_t newCap = set->tombstones * 2 > set->size ? set->capacity : set->capacity * 2;
         if (!hs_resize(set, newCap)) {
             /* if resizing fails, we can try to continue anyway, but collisions might skyrocket. */
         }
     }
-    size_t h = set->hashFn(elem);
-    size_t index = h % set->capacity;
-    size_t i;
-    size_t firstRemovedIndex = (size_t)-1; /* track first tombstone slot if found */
+}
 
-    for (i = 0; i < set->capacity; i++) {
-        size_t probe = (index + i) % set->capacity;
-        HS_Slot* slot = &set->slots[probe];
-
-        if (slot->state == SLOT_EMPTY) {
-            /* use either this slot or previously found tombstone */
-            size_t finalPos = (firstRemovedIndex == (size_t)-1) ? probe : firstRemovedIndex;
-            HS_Slot* finalSlot = &set->slots[finalPos];
-            finalSlot->data = elem;
-            finalSlot->hash = h;
-            finalSlot->state= SLOT_FILLED;
-            set->size++;
-            return true;
+/*
+ * Inserts an element known to be absent. Linear probing takes the first
+ * tombstone or EMPTY slot of the probe.
+ */
+static bool hs_insert_new(HashSet* set, void* elem, size_t h) {
+    hs_make_room(set);
+    if (set->size == set->capacity) {
+        return false; /* full and could not grow */
+    }
+    if (set->probing == HS_ROBIN_HOOD) {
+        hs_rh_place(set, elem, h);
+    }
+    else {
+        size_t probe = h % set->capacity;
+        while (set->meta[probe] & HS_META_FULL) {
+            probe = hs_next(set, probe);
         }
-        else if (slot->state == SLOT_REMOVED) {
-            /* record the tombstone if we haven't yet */
-            if (firstRemovedIndex == (size_t)-1) {
-                firstRemovedIndex = probe;
-            }
+        if (set->meta[probe] == HS_META_REMOVED) {
+            set->tombstones--;
         }
-        else if (slot->state == SLOT_FILLED) {
-            /* check if it's the same element */
-            if (slot->hash == h && set->eqFn(slot->data, elem)) {
-                /* already in the set => no-op */
-                return true;
-            }
+        hs_put(set, probe, elem, h);
+    }
+    set->size++;
+    return true;
+}
+
+/* Removes the element in slot 'pos'. */
+static void hs_remove_at(HashSet* set, size_t pos) {
+    if (set->probing == HS_ROBIN_HOOD) {
+        /* backward shift: pull displaced successors one slot closer to home */
+        size_t hole = pos;
+        size_t next = hs_next(set, hole);
+        while (set->meta[next] != HS_META_EMPTY
+               && hs_dist(set, next, set->hashes[next]) > 0) {
+            set->meta[hole]   = set->meta[next];
+            set->hashes[hole] = set->hashes[next];
+            set->data[hole]   = set->data[next];
+            hole = next;
+            next = hs_next(set, next);
         }
+        set->meta[hole] = HS_META_EMPTY;
+        set->data[hole] = NULL;
     }
-    /* table is full (or highly colliding) */
-    return false;
+    else {
+        /* mark removed */
+        set->meta[pos] = HS_META_REMOVED;
+        set->data[pos] = NULL; /* user must free separately if needed */
+        set->tombstones++;
+    }
+    set->size--;
 }
 
 /*
- * Contains
+ * Insert or do nothing if element is already in the set.
  */
-bool hs_contains(const HashSet* set, const void* elem) {
+bool hs_insert(HashSet* set, void* elem) {
     if (!set || !elem) return false;
     size_t h = set->hashFn(elem);
-    size_t index = h % set->capacity;
-    size_t i;
-    for (i = 0; i < set->capacity; i++) {
-        size_t probe = (index + i) % set->capacity;
-        const HS_Slot* slot = &set->slots[probe];
-        if (slot->state == SLOT_EMPTY) {
-            /* can't be further in open addressing => not found */
-            return false;
-        }
-        else if (slot->state == SLOT_FILLED) {
-            if (slot->hash == h && set->eqFn(slot->data, elem)) {
-                return true;
-            }
-        }
-        /* if SLOT_REMOVED, we keep searching */
+    if (hs_find(set, elem, h) != (size_t)-1) {
+        /* already in the set => no-op */
+        return true;
     }
-    return false;
+    return hs_insert_new(set, elem, h);
+}
+
+/*
+ * Contains
+ */
+bool hs_contains(const HashSet* set, const void* elem) {
+    if (!set || !elem) return false;
+    return hs_find(set, elem, set->hashFn(elem)) != (size_t)-1;
 }
 
 /*
@@ -597,41 +1619,122 @@ bool hs_contains(const HashSet* set, const void* elem) {
  */
 bool hs_remove(HashSet* set, const void* elem) {
     if (!set || !elem) return false;
-    size_t h = set->hashFn(elem);
-    size_t index = h % set->capacity;
+    size_t pos = hs_find(set, elem, set->hashFn(elem));
+    if (pos == (size_t)-1) {
+        return false;
+    }
+    hs_remove_at(set, pos);
+    return true;
+}
+
+/*
+ * Iterate
+ */
+void hs_iterate(const HashSet* set, HS_IterFn fn, void* userData) {
+    if (!set || !fn) return;
     size_t i;
     for (i = 0; i < set->capacity; i++) {
-        size_t probe = (index + i) % set->capacity;
-        HS_Slot* slot = &set->slots[probe];
-        if (slot->state == SLOT_EMPTY) {
-            /* not found */
+        if (set->meta[i] & HS_META_FULL) {
+            fn(set->data[i], userData);
+        }
+    }
+}
+
+size_t hs_size(const HashSet* set) {
+    return set ? set->size : 0;
+}
+
+size_t hs_capacity(const HashSet* set) {
+    return set ? set->capacity : 0;
+}
+
+/*
+ * Stoppable / ranged iteration
+ */
+bool hs_iterate_until(const HashSet* set, HS_VisitFn fn, void* userData) {
+    return hs_iterate_range(set, 0, (size_t)-1, fn, userData);
+}
+
+bool hs_iterate_range(const HashSet* set, size_t begin_slot, size_t end_slot,
+                      HS_VisitFn fn, void* userData) {
+    if (!set || !fn) return true;
+    if (end_slot > set->capacity) end_slot = set->capacity;
+    size_t i;
+    for (i = begin_slot; i < end_slot; i++) {
+        if ((set->meta[i] & HS_META_FULL) && !fn(set->data[i], userData)) {
             return false;
         }
-        else if (slot->state == SLOT_FILLED) {
-            if (slot->hash == h && set->eqFn(slot->data, elem)) {
-                /* found => mark removed */
-                slot->state = SLOT_REMOVED;
-                slot->data  = NULL; /* user must free separately if needed */
-                set->size--;
-                return true;
-            }
+    }
+    return true;
+}
+
+void hs_iter_init(const HashSet* set, HSIter* it) {
+    hs_iter_init_range(set, it, 0, (size_t)-1);
+}
+
+void hs_iter_init_range(const HashSet* set, HSIter* it, size_t begin_slot, size_t end_slot) {
+    if (!it) return;
+    it->set = set;
+    it->pos = begin_slot;
+    it->end = end_slot;
+}
+
+bool hs_iter_next(HSIter* it, void** elem) {
+    if (!it || !it->set) return false;
+    const HashSet* set = it->set;
+    /* re-read the capacity every step: the set may have been rehashed */
+    while (it->pos < it->end && it->pos < set->capacity) {
+        size_t i = it->pos++;
+        if (set->meta[i] & HS_META_FULL) {
+            if (elem) *elem = set->data[i];
+            return true;
         }
     }
     return false;
 }
 
 /*
- * Iterate
+ * Stats: the probe length of an element is its distance from home + 1
+ * (tombstones on the way count, a lookup inspects them too).
  */
-void hs_iterate(const HashSet* set, HS_IterFn fn, void* userData) {
-    if (!set || !fn) return;
-    size_t i;
+void hs_stats(const HashSet* set, HSStats* st) {
+    if (!st) return;
+    memset(st, 0, sizeof(*st));
+    if (!set) return;
+    size_t i, total = 0;
+    st->size = set->size;
+    st->capacity = set->capacity;
+    st->tombstones = set->tombstones;
+    st->load_factor = (double)set->size / (double)set->capacity;
+    st->memory_bytes = sizeof(HashSet) + set->capacity * (sizeof(void*) + sizeof(size_t) + 1);
     for (i = 0; i < set->capacity; i++) {
-        const HS_Slot* slot = &set->slots[i];
-        if (slot->state == SLOT_FILLED) {
-            fn(slot->data, userData);
-        }
+        if (!(set->meta[i] & HS_META_FULL)) continue;
+        size_t probe = hs_dist(set, i, set->hashes[i]) + 1;
+        total += probe;
+        if (probe > st->max_probe) st->max_probe = probe;
+        st->probe_hist[probe < HS_PROBE_HIST_BUCKETS ? probe - 1 : HS_PROBE_HIST_BUCKETS - 1]++;
+    }
+    st->avg_probe = set->size ? (double)total / (double)set->size : 0.0;
+}
+
+/*
+ * Shrink: smallest capacity that holds the elements plus one more within
+ * the load factor, so the next insert does not grow the set straight back
+ */
+bool hs_shrink_to_fit(HashSet* set) {
+    if (!set) return false;
+    size_t newCap = (size_t)((double)(set->size + 1) / set->maxLoadFactor) + 1;
+    if (newCap < 4) {
+        newCap = 4;
+    }
+    /* same float test as hs_make_room, so rounding cannot leave it one short */
+    while ((float)(set->size + 1) > set->maxLoadFactor * (float)newCap) {
+        newCap += newCap / 64 + 1;
+    }
+    if (newCap >= set->capacity && set->tombstones == 0) {
+        return true;
     }
+    return hs_resize(set, newCap < set->capacity ? newCap : set->capacity);
 }
 
 /*
@@ -639,56 +1742,403 @@ void hs_iterate(const HashSet* set, HS_IterFn fn, void* userData) {
  */
 void hs_destroy(HashSet* set) {
     if (!set) return;
-    free(set->slots);
+    free(set->data);
     free(set);
 }
 
 /*
- * Optionally, resizing function if we want the set to grow when load factor is exceeded.
+ * Rehashes into 'newCap' slots (growth, compaction or shrinking); the new
+ * arrays have no tombstones, so every element goes to the first free slot
+ * of its probe (Robin Hood: its displacement-ordered place).
  */
 static bool hs_resize(HashSet* set, size_t newCap) {
-    HS_Slot* newSlots = (HS_Slot*)calloc(newCap, sizeof(HS_Slot));
-    if (!newSlots) {
+    HashSet old = *set;
+    if (!hs_alloc(set, newCap)) {
         return false;
     }
-    /* re-insert from old array */
-    HS_Slot* oldSlots = set->slots;
-    size_t oldCap = set->capacity;
+    set->tombstones = 0;
+
+    size_t i;
+    for (i = 0; i < old.capacity; i++) {
+        if (!(old.meta[i] & HS_META_FULL)) {
+            continue;
+        }
+        void* elem = old.data[i];
+        size_t h = old.hashes[i];
+        if (set->probing == HS_ROBIN_HOOD) {
+            hs_rh_place(set, elem, h);
+        }
+        else {
+            size_t probe = h % set->capacity;
+            while (set->meta[probe] != HS_META_EMPTY) {
+                probe = hs_next(set, probe);
+            }
+            hs_put(set, probe, elem, h);
+        }
+    }
+    free(old.data);
+    return true;
+}
+
+/* ---------------------------------------------------------
+ * Set algebra
+ * ---------------------------------------------------------
+ * Every operation is a scan of one set's slot array that looks each
+ * element up in the other set (reusing the cached hash: both sets share
+ * hashFn) and records the hits, followed by a sequential merge that
+ * inserts / removes them. With a ThreadPool the slot array is cut into
+ * slices scanned by pool tasks; the merge stays on the calling thread.
+ */
+#define HS_PAR_MAX_PARTS 64
+#define HS_PAR_MIN_SLOTS 8192  /* smaller slices are not worth a task */
 
-    set->slots = newSlots;
-    set->capacity = newCap;
-    set->size = 0; /* will re-count as we insert */
+typedef enum {
+    HS_WANT_FOUND,    /* elements present in 'probe' */
+    HS_WANT_MISSING,  /* elements absent from 'probe' */
+    HS_WANT_ALL       /* both; 'pos' tells them apart */
+} HSWant;
 
+typedef struct {
+    void*  elem;
+    size_t hash;
+    size_t pos;   /* slot in 'probe', or (size_t)-1 */
+} HSHit;
+
+typedef struct HSJob HSJob;
+
+typedef struct {
+    HSJob*  job;
+    size_t  begin, end;  /* slots of 'scan' */
+    HSHit*  hits;
+    size_t  count;
+    size_t  cap;
+    bool    failed;      /* out of memory */
+} HSPart;
+
+struct HSJob {
+    const HashSet* scan;
+    const HashSet* probe;
+    HSWant         want;
+    bool           take_probe;  /* record the element stored in 'probe' */
+    bool           stop_on_hit; /* only whether there is a hit matters */
+    volatile int   stop;
+    volatile int   refs;        /* pool tasks + caller; the last one frees */
+    Latch          done;
+    size_t         nparts;
+    HSPart         parts[HS_PAR_MAX_PARTS];
+};
+
+static void hs_job_release(HSJob* job) {
+    if (adv_atomic_fetch_add_int(&job->refs, -1, ADV_ACQ_REL) == 1) {
+        size_t i;
+        for (i = 0; i < job->nparts; i++) {
+            free(job->parts[i].hits);
+        }
+        Latch_destroy(&job->done);
+        free(job);
+    }
+}
+
+static bool hs_part_push(HSPart* p, void* elem, size_t hash, size_t pos) {
+    if (p->count == p->cap) {
+        size_t newCap = p->cap ? p->cap * 2 : 64;
+        HSHit* grown = (HSHit*)realloc(p->hits, newCap * sizeof(HSHit));
+        if (!grown) {
+            return false;
+        }
+        p->hits = grown;
+        p->cap = newCap;
+    }
+    p->hits[p->count].elem = elem;
+    p->hits[p->count].hash = hash;
+    p->hits[p->count].pos  = pos;
+    p->count++;
+    return true;
+}
+
+static void hs_scan_part(HSPart* p) {
+    HSJob* job = p->job;  /* not const: any part may raise job->stop */
+    const HashSet* scan = job->scan;
+    const HashSet* probe = job->probe;
     size_t i;
-    for (i = 0; i < oldCap; i++) {
-        if (oldSlots[i].state == SLOT_FILLED) {
-            /* re-insert */
-            void* elem = oldSlots[i].data;
-            size_t h = oldSlots[i].hash;
-            /* do normal insertion logic, but we skip eq check since we know it's unique. */
-            size_t index = h % set->capacity;
-            size_t j;
-            size_t firstRemovedIdx = (size_t)-1;
-            for (j = 0; j < set->capacity; j++) {
-                size_t probe = (index + j) % set->capacity;
-                HS_Slot* slot = &set->slots[probe];
-                if (slot->state == SLOT_EMPTY) {
-                    size_t finalP = (firstRemovedIdx == (size_t)-1) ? probe : firstRemovedIdx;
-                    HS_Slot* fs = &set->slots[finalP];
-                    fs->data = elem;
-                    fs->hash = h;
-                    fs->state= SLOT_FILLED;
-                    set->size++;
-                    break;
-                }
-                else if (slot->state == SLOT_REMOVED) {
-                    if (firstRemovedIdx == (size_t)-1) {
-                        firstRemovedIdx = probe;
-                    }
-                }
+    for (i = p->begin; i < p->end; i++) {
+        if ((i & 255) == 0 && adv_atomic_load_int(&job->stop, ADV_RELAXED)) {
+            return;
+        }
+        if (!(scan->meta[i] & HS_META_FULL)) {
+            continue;
+        }
+        size_t h = scan->hashes[i];
+        size_t pos = hs_find(probe, scan->data[i], h);
+        bool found = pos != (size_t)-1;
+        if (job->want != HS_WANT_ALL && found != (job->want == HS_WANT_FOUND)) {
+            continue;
+        }
+        if (job->stop_on_hit) {
+            p->count++;
+            adv_atomic_store_int(&job->stop, 1, ADV_RELAXED);
+            return;
+        }
+        void* elem = (found && job->take_probe) ? probe->data[pos] : scan->data[i];
+        if (!hs_part_push(p, elem, h, pos)) {
+            p->failed = true;
+            adv_atomic_store_int(&job->stop, 1, ADV_RELAXED);
+            return;
+        }
+    }
+}
+
+static void hs_part_task(void* arg) {
+    HSPart* p = (HSPart*)arg;
+    HSJob* job = p->job;
+    hs_scan_part(p);
+    Latch_count_down(&job->done, 1);
+    hs_job_release(job);
+}
+
+/*
+ * Scans 'scan' against 'probe', in slices on 'pool' if it is large enough.
+ * Returns the finished job (release it with hs_job_release), or NULL.
+ */
+static HSJob* hs_run_scan(const HashSet* scan, const HashSet* probe, HSWant want,
+                          bool take_probe, bool stop_on_hit, ThreadPool* pool) {
+    size_t nparts = pool ? scan->capacity / HS_PAR_MIN_SLOTS : 1;
+    size_t i;
+    if (nparts > HS_PAR_MAX_PARTS) nparts = HS_PAR_MAX_PARTS;
+    if (nparts < 1) nparts = 1;
+
+    HSJob* job = (HSJob*)calloc(1, sizeof(HSJob));
+    if (!job) return NULL;
+    if (!Latch_init(&job->done, (unsigned int)nparts)) {
+        free(job);
+        return NULL;
+    }
+    job->scan = scan;
+    job->probe = probe;
+    job->want = want;
+    job->take_probe = take_probe;
+    job->stop_on_hit = stop_on_hit;
+    job->nparts = nparts;
+    job->refs = (int)nparts + 1;
+    for (i = 0; i < nparts; i++) {
+        job->parts[i].job   = job;
+        job->parts[i].begin = scan->capacity * i / nparts;
+        job->parts[i].end   = scan->capacity * (i + 1) / nparts;
+    }
+    /* the caller scans the last slice itself */
+    for (i = 0; i + 1 < nparts; i++) {
+        if (!thread_pool_submit(pool, hs_part_task, &job->parts[i])) {
+            hs_part_task(&job->parts[i]);
+        }
+    }
+    hs_scan_part(&job->parts[nparts - 1]);
+    Latch_count_down(&job->done, 1);
+    adv_atomic_fetch_add_int(&job->refs, -1, ADV_ACQ_REL);  /* the last slice's reference */
+    Latch_wait(&job->done);
+
+    for (i = 0; i < nparts; i++) {
+        if (job->parts[i].failed) {
+            hs_job_release(job);
+            return NULL;
+        }
+    }
+    return job;
+}
+
+static size_t hs_job_hits(const HSJob* job) {
+    size_t i, n = 0;
+    for (i = 0; i < job->nparts; i++) {
+        n += job->parts[i].count;
+    }
+    return n;
+}
+
+/* Empty set configured like 'like', with room for 'n' elements. */
+static HashSet* hs_new_like(const HashSet* like, size_t n) {
+    return hs_create_ex((size_t)((double)n / like->maxLoadFactor) + 1, like->hashFn,
+                        like->eqFn, like->probing, like->maxLoadFactor);
+}
+
+/* Copy of 'src' configured like 'like' (probing, load factor), with room for 'n' elements. */
+static HashSet* hs_clone(const HashSet* like, const HashSet* src, size_t n) {
+    HashSet* r = hs_new_like(like, n > src->size ? n : src->size);
+    size_t i;
+    if (!r) return NULL;
+    for (i = 0; i < src->capacity; i++) {
+        if ((src->meta[i] & HS_META_FULL) && !hs_insert_new(r, src->data[i], src->hashes[i])) {
+            hs_destroy(r);
+            return NULL;
+        }
+    }
+    return r;
+}
+
+/* Grows 'set' so that 'n' elements fit without a rehash. */
+static bool hs_reserve(HashSet* set, size_t n) {
+    size_t needed = (size_t)((double)(n + set->tombstones) / set->maxLoadFactor) + 1;
+    return needed <= set->capacity || hs_resize(set, needed);
+}
+
+/*
+ * Applies a scan's hits to 'dst': HS_WANT_ALL hits found in 'dst' have
+ * their stored pointer replaced, the others are inserted; with 'remove'
+ * the hits are removed from 'dst' instead.
+ */
+static bool hs_apply_hits(HashSet* dst, const HSJob* job, bool remove) {
+    size_t i, j;
+    if (job->want == HS_WANT_ALL) {
+        /* overwrite first: inserts may move elements (Robin Hood) */
+        for (i = 0; i < job->nparts; i++) {
+            for (j = 0; j < job->parts[i].count; j++) {
+                const HSHit* hit = &job->parts[i].hits[j];
+                if (hit->pos != (size_t)-1) dst->data[hit->pos] = hit->elem;
             }
         }
     }
-    free(oldSlots);
+    for (i = 0; i < job->nparts; i++) {
+        for (j = 0; j < job->parts[i].count; j++) {
+            const HSHit* hit = &job->parts[i].hits[j];
+            if (remove) {
+                size_t pos = hs_find(dst, hit->elem, hit->hash);
+                if (pos != (size_t)-1) hs_remove_at(dst, pos);
+            }
+            else if (hit->pos == (size_t)-1 || job->want != HS_WANT_ALL) {
+                if (!hs_insert_new(dst, hit->elem, hit->hash)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool hs_compatible(const HashSet* a, const HashSet* b) {
+    return a && b && a->hashFn == b->hashFn && a->eqFn == b->eqFn;
+}
+
+HashSet* hs_union(const HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return NULL;
+    /*
+     * copy the larger set into a set configured like a, then add the
+     * smaller one; shared elements keep a's pointer
+     */
+    const HashSet* big   = a->size >= b->size ? a : b;
+    const HashSet* small = big == a ? b : a;
+    HashSet* r = hs_clone(a, big, a->size + b->size);
+    if (!r) return NULL;
+    HSJob* job = hs_run_scan(small, r, small == a ? HS_WANT_ALL : HS_WANT_MISSING, false, false, pool);
+    bool ok = job && hs_apply_hits(r, job, false);
+    if (job) hs_job_release(job);
+    if (!ok) {
+        hs_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+HashSet* hs_intersect(const HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return NULL;
+    const HashSet* small = a->size <= b->size ? a : b;
+    const HashSet* big   = small == a ? b : a;
+    HSJob* job = hs_run_scan(small, big, HS_WANT_FOUND, small == b, false, pool);
+    if (!job) return NULL;
+    HashSet* r = hs_new_like(a, hs_job_hits(job));
+    if (r && !hs_apply_hits(r, job, false)) {
+        hs_destroy(r);
+        r = NULL;
+    }
+    hs_job_release(job);
+    return r;
+}
+
+HashSet* hs_difference(const HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return NULL;
+    HSJob* job;
+    HashSet* r;
+    if (a->size <= b->size) {
+        /* keep the elements of a missing from b */
+        job = hs_run_scan(a, b, HS_WANT_MISSING, false, false, pool);
+        if (!job) return NULL;
+        r = hs_new_like(a, hs_job_hits(job));
+        if (r && !hs_apply_hits(r, job, false)) {
+            hs_destroy(r);
+            r = NULL;
+        }
+    }
+    else {
+        /* copy a, then remove the elements of b found in it */
+        r = hs_clone(a, a, a->size);
+        if (!r) return NULL;
+        job = hs_run_scan(b, r, HS_WANT_FOUND, true, false, pool);
+        if (!job) {
+            hs_destroy(r);
+            return NULL;
+        }
+        hs_apply_hits(r, job, true);
+    }
+    hs_job_release(job);
+    return r;
+}
+
+bool hs_is_subset(const HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return false;
+    if (a->size > b->size) return false;
+    HSJob* job = hs_run_scan(a, b, HS_WANT_MISSING, false, true, pool);
+    if (!job) return false;
+    bool subset = hs_job_hits(job) == 0;
+    hs_job_release(job);
+    return subset;
+}
+
+bool hs_union_inplace(HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return false;
+    if (a == b) return true;
+    if (!hs_reserve(a, a->size + b->size)) return false;
+    HSJob* job = hs_run_scan(b, a, HS_WANT_MISSING, false, false, pool);
+    if (!job) return false;
+    bool ok = hs_apply_hits(a, job, false);
+    hs_job_release(job);
+    return ok;
+}
+
+bool hs_intersect_inplace(HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return false;
+    if (a == b) return true;
+    if (a->size <= b->size) {
+        /* remove the elements of a missing from b */
+        HSJob* job = hs_run_scan(a, b, HS_WANT_MISSING, false, false, pool);
+        if (!job) return false;
+        hs_apply_hits(a, job, true);
+        hs_job_release(job);
+        return true;
+    }
+    /* b is smaller: collect a's elements found from b and rebuild a from them */
+    HSJob* job = hs_run_scan(b, a, HS_WANT_FOUND, true, false, pool);
+    if (!job) return false;
+    HashSet* r = hs_new_like(a, hs_job_hits(job));
+    bool ok = r && hs_apply_hits(r, job, false);
+    hs_job_release(job);
+    if (!ok) {
+        hs_destroy(r);
+        return false;
+    }
+    free(a->data);
+    a->meta       = r->meta;
+    a->hashes     = r->hashes;
+    a->data       = r->data;
+    a->capacity   = r->capacity;
+    a->size       = r->size;
+    a->tombstones = r->tombstones;
+    free(r);
+    return true;
+}
+
+bool hs_difference_inplace(HashSet* a, const HashSet* b, ThreadPool* pool) {
+    if (!hs_compatible(a, b)) return false;
+    /* remove the elements found in both, scanning the smaller set */
+    HSJob* job = b->size < a->size
+        ? hs_run_scan(b, a, HS_WANT_FOUND, true, false, pool)
+        : hs_run_scan(a, b, HS_WANT_FOUND, false, false, pool);
+    if (!job) return false;
+    hs_apply_hits(a, job, true);
+    hs_job_release(job);
     return true;
 }
@@ -4,6 +4,7 @@
  * A collection of extended containers in C99:
  *   1) Dynamic Array
  *   2) Hash Table (string -> void*)
+ *   2b) Concurrent Hash Table (string -> void*, thread-safe)
  *   3) Red-Black Tree (int -> void*)
  *   4) HashSet (set of strings)
  * plus higher-order functions (map, filter, reduce) for the dynamic array.
@@ -16,6 +17,8 @@
 
 #include <stddef.h>  /* size_t */
 #include <stdbool.h> /* bool */
+#include <stdint.h>  /* uint64_t */
+#include "thread_pool.h"
 
 /* ---------------------------------------------------------
  * 1) DYNAMIC ARRAY
@@ -49,12 +52,138 @@ void* da_reduce(const DynArray* arr, void* init, ReduceFn fn);
  * --------------------------------------------------------- */
 typedef struct HashTable HashTable;
 
+/*
+ * The hash HashTable uses: wyhash-style, reads 8 bytes at a time and mixes
+ * with 64x64->128 multiplies. Each table draws its own random 'seed' so that
+ * colliding keys cannot be precomputed (hash flooding). Also handy as an
+ * HS_HashFn building block.
+ */
+uint64_t   ht_hash(const void* data, size_t len, uint64_t seed);
+
+/*
+ * The table grows by itself: once an insert would push the load factor over
+ * 0.75, a table twice as large is allocated and the entries are moved over
+ * incrementally, a few slots per following insert/remove (no long pause).
+ * 'capacity' is only the starting size (rounded up to a power of two, at least 16).
+ *
+ * Keys are copied: up to 15 bytes inline in the slot, longer ones into a key
+ * arena owned by the table (no malloc per entry; ht_destroy frees a handful
+ * of blocks).
+ */
 HashTable* ht_create(size_t capacity);
 bool       ht_insert(HashTable* ht, const char* key, void* value);
 void*      ht_get(const HashTable* ht, const char* key);
+
+/*
+ * Same as ht_insert / ht_get / ht_remove, but the key is the 'len' bytes at
+ * 'key' and need not be NUL-terminated (e.g. a slice of a larger buffer).
+ * ht_insert_n stores a NUL-terminated copy of those bytes. Keys are limited
+ * to 2^32 - 1 bytes.
+ */
+bool       ht_insert_n(HashTable* ht, const char* key, size_t len, void* value);
+void*      ht_get_n(const HashTable* ht, const char* key, size_t len);
+void*      ht_remove_n(HashTable* ht, const char* key, size_t len);
+
+/*
+ * Removes 'key' and returns its value (NULL if absent). Uses backward-shift
+ * deletion: later entries of the same probe chain move back into the freed
+ * slot, so lookups never stop early and no tombstones pile up under churn.
+ */
 void*      ht_remove(HashTable* ht, const char* key);
 void       ht_destroy(HashTable* ht);
 
+/*
+ * Makes room for 'n' entries in total, so that inserting up to that many
+ * never triggers a grow. Moves the entries at once if the table has to grow
+ * (and completes a pending incremental rehash). False if out of memory.
+ */
+bool       ht_reserve(HashTable* ht, size_t n);
+
+/*
+ * Inserts keys[i] -> values[i] for i < n ('values' may be NULL: all NULL
+ * values), with the same semantics as n calls of ht_insert, but reserves
+ * room once and hashes + prefetches the keys in batches ahead of inserting.
+ * Returns false on out-of-memory or on a NULL or over-long key (as
+ * ht_insert would); either way the keys before the failing one are in and
+ * the ones after it are not.
+ */
+bool       ht_insert_bulk(HashTable* ht, const char* const* keys, void* const* values, size_t n);
+
+/*
+ * Looks up keys[0..n-1] and stores each value (NULL if absent) in
+ * out_values[i]; returns the number of keys found. Faster than n ht_get
+ * calls on tables larger than the cache: keys are hashed and their slots
+ * prefetched in batches, so the memory latency of a batch overlaps.
+ */
+size_t     ht_get_batch(const HashTable* ht, const char* const* keys, size_t n, void** out_values);
+
+/*
+ * Cursor over all entries, in no particular order. The table must not be
+ * modified while iterating; returned keys point into the table and stay
+ * valid until the next modification.
+ *
+ *   HTIter it; const char* k; void* v;
+ *   ht_iter_init(ht, &it);
+ *   while (ht_iter_next(&it, &k, NULL, &v)) { ... }
+ */
+typedef struct {
+    const HashTable* ht;
+    size_t           pos;
+} HTIter;
+
+void       ht_iter_init(const HashTable* ht, HTIter* it);
+
+/* Advances to the next entry; any of the outputs may be NULL. False at the end. */
+bool       ht_iter_next(HTIter* it, const char** key, size_t* key_len, void** value);
+
+/* Probe-length statistics (a probe length of 1 means the key sits in its home slot) */
+typedef struct {
+    size_t count;              /* entries */
+    size_t capacity;           /* slots in the current table */
+    double load_factor;        /* entries in the current table / capacity */
+    double avg_probe;          /* mean probe length over all entries */
+    size_t max_probe;          /* longest probe length */
+    bool   rehashing;          /* an incremental rehash is in progress */
+    size_t pending_migration;  /* entries still in the previous table */
+    size_t memory_bytes;       /* slot arrays + key arena (malloc overhead not included) */
+} HTStats;
+
+void       ht_stats(const HashTable* ht, HTStats* st);
+
+/* ---------------------------------------------------------
+ * 2b) CONCURRENT HASH TABLE (string -> void*, thread-safe)
+ * ---------------------------------------------------------
+ * Lock-striped: 'shards' independent HashTables (rounded up to a power of
+ * two, 0 picks 128), each behind its own RWLock, so threads only contend
+ * when they hit the same shard, and readers of a shard run in parallel.
+ * All functions may be called from any thread; only cht_destroy must not
+ * overlap with anything else.
+ */
+typedef struct ConcurrentHashTable ConcurrentHashTable;
+
+/* 'capacity' is the starting size of the whole table, split across the shards */
+ConcurrentHashTable* cht_create(size_t capacity, size_t shards);
+void*  cht_get(const ConcurrentHashTable* t, const char* key);
+
+/* Stores key -> value, replacing the value if the key exists. False if out of memory. */
+bool   cht_insert_or_assign(ConcurrentHashTable* t, const char* key, void* value);
+
+/*
+ * Returns the value of 'key'; if absent, calls fn(key, userData) once, under
+ * the shard's write lock (so concurrent callers for the same key wait rather
+ * than compute twice), and stores its result. A NULL result stores nothing.
+ */
+typedef void* (*CHT_ComputeFn)(const char* key, void* userData);
+void*  cht_compute_if_absent(ConcurrentHashTable* t, const char* key,
+                             CHT_ComputeFn fn, void* userData);
+
+/* Removes 'key' and returns its value (NULL if absent) */
+void*  cht_remove(ConcurrentHashTable* t, const char* key);
+
+/* Entry count (a snapshot: other threads may be changing it) */
+size_t cht_size(const ConcurrentHashTable* t);
+void   cht_destroy(ConcurrentHashTable* t);
+
 /* ---------------------------------------------------------
  * 3) RED-BLACK TREE (int -> void*)
  * --------------------------------------------------------- */
@@ -92,6 +221,38 @@ HashSet* hs_create(size_t initial_capacity,
                    HS_HashFn hashFn,
                    HS_EqFn   eqFn);
 
+/*
+ * Collision strategy:
+ *   - HS_LINEAR_PROBING: linear probing, removals leave tombstones (hs_create).
+ *   - HS_ROBIN_HOOD: linear probing ordered by displacement. An insert takes
+ *     the slot of any element sitting closer to its home slot and moves that
+ *     one on, which keeps probe lengths short and even (O(log n) worst case
+ *     w.h.p.); a lookup stops as soon as it meets an element closer to home
+ *     than the one it looks for, so misses end early too. Removals shift the
+ *     following elements back (no tombstones).
+ */
+typedef enum {
+    HS_LINEAR_PROBING = 0,
+    HS_ROBIN_HOOD     = 1
+} HSProbing;
+
+/*
+ * Like hs_create, with an explicit collision strategy and maximum load
+ * factor: the set is rehashed once elements + tombstones would exceed
+ * max_load_factor * capacity (0 = default 0.75; otherwise it must lie in
+ * [HS_MIN_LOAD_FACTOR, HS_MAX_LOAD_FACTOR], else NULL is returned).
+ * The rehash doubles the capacity, or keeps it and just drops the
+ * tombstones when they are more than half as many as the elements.
+ */
+#define HS_MIN_LOAD_FACTOR 0.1f
+#define HS_MAX_LOAD_FACTOR 0.95f
+
+HashSet* hs_create_ex(size_t initial_capacity,
+                      HS_HashFn hashFn,
+                      HS_EqFn   eqFn,
+                      HSProbing probing,
+                      float     max_load_factor);
+
 /*
  * Inserts 'elem' into the set (duplicates are no-ops).
  * Returns true if insertion succeeds or if the element already in the set,
@@ -117,6 +278,102 @@ bool hs_remove(HashSet* set, const void* elem);
 typedef void (*HS_IterFn)(void* elem, void* userData);
 void hs_iterate(const HashSet* set, HS_IterFn fn, void* userData);
 
+/* Number of elements, and number of slots (the range of slot indices) */
+size_t hs_size(const HashSet* set);
+size_t hs_capacity(const HashSet* set);
+
+/*
+ * Stoppable iteration: fn returns true to continue, false to stop.
+ * hs_iterate_range only visits the elements stored in slots
+ * [begin_slot, end_slot) (end_slot is clamped to hs_capacity), so disjoint
+ * ranges can be scanned by different threads while nobody modifies the
+ * set. Both return true if every element was visited, false if fn stopped.
+ */
+typedef bool (*HS_VisitFn)(void* elem, void* userData);
+bool hs_iterate_until(const HashSet* set, HS_VisitFn fn, void* userData);
+bool hs_iterate_range(const HashSet* set, size_t begin_slot, size_t end_slot,
+                      HS_VisitFn fn, void* userData);
+
+/*
+ * Cursor over the elements, for scanning a few elements at a time. Stays
+ * safe to use if the set is modified in between, but may then skip or
+ * repeat elements (except after removing, with linear probing, the
+ * element it just returned: removals there never move other elements).
+ *
+ *   HSIter it; void* e;
+ *   hs_iter_init(set, &it);
+ *   while (hs_iter_next(&it, &e)) { ... }
+ */
+typedef struct {
+    const HashSet* set;
+    size_t         pos;  /* next slot */
+    size_t         end;  /* slot limit */
+} HSIter;
+
+void hs_iter_init(const HashSet* set, HSIter* it);
+void hs_iter_init_range(const HashSet* set, HSIter* it, size_t begin_slot, size_t end_slot);
+
+/* Advances to the next element; false at the end of the set / range. */
+bool hs_iter_next(HSIter* it, void** elem);
+
+/*
+ * Rehashes into the smallest capacity that holds the current elements and
+ * one more insert within the load factor (never grows), dropping all
+ * tombstones.
+ * Returns false if out of memory (the set is unchanged).
+ */
+bool hs_shrink_to_fit(HashSet* set);
+
+/*
+ * Probe-length statistics. The probe length of an element is the number of
+ * slots a successful lookup inspects (1 = home slot); probe_hist[i] counts
+ * the elements with probe length i + 1, the last bucket also the longer ones.
+ */
+#define HS_PROBE_HIST_BUCKETS 32
+
+typedef struct {
+    size_t size;
+    size_t capacity;
+    size_t tombstones;         /* removed slots not reused yet (linear probing) */
+    double load_factor;
+    double avg_probe;
+    size_t max_probe;
+    size_t probe_hist[HS_PROBE_HIST_BUCKETS];
+    size_t memory_bytes;       /* set header + slot arrays (malloc overhead not included) */
+} HSStats;
+
+void hs_stats(const HashSet* set, HSStats* st);
+
+/*
+ * Set algebra. Both sets must use the same hashFn and eqFn (false / NULL
+ * otherwise): cached hashes are reused instead of calling hashFn again.
+ * Each operation scans the smaller set where the result allows it and
+ * looks its elements up in the other one.
+ *
+ * Where an element is in both sets, the result keeps a's pointer. New
+ * sets take a's probing mode and load factor; they own no elements (free
+ * them through the original sets only).
+ *
+ * 'pool' may be NULL. Otherwise large scans are split into slot ranges
+ * run as tasks on the pool (plus the calling thread), so hashFn / eqFn
+ * must be safe to call concurrently, and the call must not come from a
+ * task of the same pool. Inserting / removing the results stays on the
+ * calling thread.
+ */
+
+/* New set a | b, a & b or a \ b; NULL if out of memory. */
+HashSet* hs_union(const HashSet* a, const HashSet* b, ThreadPool* pool);
+HashSet* hs_intersect(const HashSet* a, const HashSet* b, ThreadPool* pool);
+HashSet* hs_difference(const HashSet* a, const HashSet* b, ThreadPool* pool);
+
+/* a |= b, a &= b, a \= b. False if out of memory (a is then unchanged). */
+bool hs_union_inplace(HashSet* a, const HashSet* b, ThreadPool* pool);
+bool hs_intersect_inplace(HashSet* a, const HashSet* b, ThreadPool* pool);
+bool hs_difference_inplace(HashSet* a, const HashSet* b, ThreadPool* pool);
+
+/* True if every element of a is in b; stops at the first one that is not. */
+bool hs_is_subset(const HashSet* a, const HashSet* b, ThreadPool* pool);
+
 /*
  * Destroys the entire set. This does NOT free the user-stored pointers themselves.
  * Caller is responsible for freeing them if needed.
@@ -0,0 +1,555 @@
+/*
+ * ht_image.c
+ *
+ * Implementation of persistent read-only HashTable images (see ht_image.h).
+ *
+ * File layout (all integers in the writer's byte order):
+ *
+ *   HTImageHeader
+ *   uint32_t disp[nbuckets]     HT_IMAGE_PERFECT only: per-bucket displacement
+ *   uint64_t slots[nslots]      0 = empty, else (entry offset << 16) | 16-bit hash tag
+ *   entries, each 8-byte aligned:
+ *       uint32_t key_len, value_len
+ *       key bytes, '\0', padding to 8
+ *       value bytes, '\0', padding to 8
+ *
+ * by Vladislav Tislenko aka keklick1337 (2025)
+ */
+
+#if defined(__linux__)
+  #define _GNU_SOURCE   /* mmap, fstat, open */
+#endif
+
+#include "ht_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define HTI_MAGIC      "C99XHTI"
+#define HTI_VERSION    1
+#define HTI_BYTE_ORDER 0x01020304u
+#define HTI_SEED       0x6a09e667f3bcc908ULL  /* images are deterministic */
+
+/* Keys per bucket of the perfect hash (lambda) */
+#define HTI_BUCKET_KEYS 4
+/* Seeds tried before a perfect-hash build gives up */
+#define HTI_MAX_RESEEDS 16
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t mode;
+    uint32_t reserved;
+    uint64_t seed;
+    uint64_t count;
+    uint64_t nslots;
+    uint64_t nbuckets;
+    uint64_t disp_off;
+    uint64_t slots_off;
+    uint64_t file_size;
+} HTImageHeader;
+
+struct HTImage {
+    const unsigned char* base;
+    size_t               size;
+    const HTImageHeader* hdr;
+    const uint32_t*      disp;
+    const uint64_t*      slots;
+#if defined(_WIN32)
+    HANDLE               mapping;
+#endif
+};
+
+/* ---------- hashing shared by writer and reader ---------- */
+
+#define HTI_TAG(h)          ((uint64_t)(((h) >> 16) & 0xFFFF))
+#define HTI_SLOT(off, h)    (((uint64_t)(off) << 16) | HTI_TAG(h))
+#define HTI_SLOT_OFF(s)     ((s) >> 16)
+#define HTI_MAX_OFFSET      ((uint64_t)1 << 47)
+
+static inline uint64_t _hti_mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static inline size_t _hti_bucket(uint64_t h, uint64_t nbuckets) {
+    return (size_t)(((h >> 32) * nbuckets) >> 32);
+}
+
+static inline size_t _hti_perfect_slot(uint64_t h, uint32_t d, uint64_t nslots) {
+    return (size_t)(_hti_mix(h ^ ((uint64_t)d * 0x9E3779B97F4A7C15ULL)) % nslots);
+}
+
+static inline size_t _hti_align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static inline size_t _hti_entry_size(size_t key_len, size_t value_len) {
+    return 8 + _hti_align8(key_len + 1) + _hti_align8(value_len + 1);
+}
+
+/* =========================================================
+ *             WRITER
+ * ========================================================= */
+
+typedef struct {
+    const char* key;
+    size_t      key_len;
+    const void* value;
+    size_t      value_len;
+    uint64_t    hash;
+    uint64_t    offset;  /* of the entry in the file */
+} HTIEntry;
+
+/*
+ * Open addressing: load <= 0.5, linear probing from hash & mask. Only sizes
+ * the slot array and hashes the keys; the slots are filled once the entry
+ * offsets are known.
+ */
+static bool _hti_build_open(HTIEntry* e, size_t n, HTImageHeader* hdr, uint64_t** slots_out) {
+    size_t cap = 16, i;
+    while (cap < 2 * n) {
+        if (cap > ((size_t)-1 >> 2) / sizeof(uint64_t)) return false;
+        cap <<= 1;
+    }
+    uint64_t* slots = (uint64_t*)calloc(cap, sizeof(uint64_t));
+    if (!slots) return false;
+    for (i = 0; i < n; i++) {
+        e[i].hash = ht_hash(e[i].key, e[i].key_len, hdr->seed);
+    }
+    hdr->nslots = cap;
+    hdr->nbuckets = 0;
+    *slots_out = slots;
+    return true;
+}
+
+/* Scratch arrays of one perfect-hash attempt */
+typedef struct {
+    size_t*        bucket_of;  /* per entry */
+    size_t*        start;      /* nbuckets + 1: members of bucket b are members[start[b] .. start[b+1]) */
+    size_t*        members;    /* entry indices grouped by bucket */
+    size_t*        by_size;    /* bucket indices, largest bucket first */
+    unsigned char* taken;      /* per slot */
+} HTIScratch;
+
+/* Groups the entries by bucket and orders the buckets by size (counting sorts). */
+static bool _hti_group(HTIEntry* e, size_t n, uint64_t seed, size_t nbuckets, HTIScratch* sc) {
+    size_t i, b, max_size = 0;
+    for (i = 0; i < n; i++) {
+        e[i].hash = ht_hash(e[i].key, e[i].key_len, seed);
+        sc->bucket_of[i] = _hti_bucket(e[i].hash, nbuckets);
+        sc->start[sc->bucket_of[i] + 1]++;
+    }
+    for (b = 0; b < nbuckets; b++) {
+        if (sc->start[b + 1] > max_size) max_size = sc->start[b + 1];
+        sc->start[b + 1] += sc->start[b];
+    }
+    size_t* fill = (size_t*)malloc(nbuckets * sizeof(size_t));
+    size_t* cnt = (size_t*)calloc(max_size + 2, sizeof(size_t));
+    if (!fill || !cnt) {
+        free(fill);
+        free(cnt);
+        return false;
+    }
+    memcpy(fill, sc->start, nbuckets * sizeof(size_t));
+    for (i = 0; i < n; i++) sc->members[fill[sc->bucket_of[i]]++] = i;
+
+    /* position of a bucket = number of buckets larger than it + earlier ones of its size */
+    for (b = 0; b < nbuckets; b++) cnt[max_size - (sc->start[b + 1] - sc->start[b]) + 1]++;
+    for (i = 0; i <= max_size; i++) cnt[i + 1] += cnt[i];
+    for (b = 0; b < nbuckets; b++) sc->by_size[cnt[max_size - (sc->start[b + 1] - sc->start[b])]++] = b;
+    free(fill);
+    free(cnt);
+    return true;
+}
+
+/*
+ * Places the buckets largest first, each trying displacements d = 0, 1, ...
+ * until all of its keys land in distinct free slots; d is stored per bucket
+ * and order[slot] receives the entry placed there.
+ */
+static bool _hti_place(const HTIEntry* e, size_t n, size_t nbuckets, const HTIScratch* sc,
+                       uint32_t* disp, size_t* order) {
+    /* a tail bucket may need ~n tries */
+    uint64_t limit = (uint64_t)n * 64 + 1024;
+    if (limit > 0xFFFFFFFFu) limit = 0xFFFFFFFFu;
+    size_t slots_tmp[64];
+    size_t i;
+    for (i = 0; i < nbuckets; i++) {
+        size_t b = sc->by_size[i];
+        const size_t* mem = sc->members + sc->start[b];
+        size_t k = sc->start[b + 1] - sc->start[b], j, m;
+        disp[b] = 0;
+        if (k == 0) continue;
+        if (k > 64) return false;  /* pathological seed */
+        /* identical hashes can never be split: needs another seed */
+        for (j = 0; j < k; j++) {
+            for (m = 0; m < j; m++) {
+                if (e[mem[j]].hash == e[mem[m]].hash) return false;
+            }
+        }
+        uint64_t d;
+        for (d = 0; d < limit; d++) {
+            for (j = 0; j < k; j++) {
+                size_t s = _hti_perfect_slot(e[mem[j]].hash, (uint32_t)d, n);
+                if (sc->taken[s]) break;
+                for (m = 0; m < j && slots_tmp[m] != s; m++) {}
+                if (m < j) break;
+                slots_tmp[j] = s;
+            }
+            if (j == k) break;
+        }
+        if (d == limit) return false;
+        disp[b] = (uint32_t)d;
+        for (j = 0; j < k; j++) {
+            sc->taken[slots_tmp[j]] = 1;
+            order[slots_tmp[j]] = mem[j];
+        }
+    }
+    return true;
+}
+
+/* One hash-and-displace attempt with 'seed': keys go to buckets by the high hash bits. */
+static bool _hti_try_perfect(HTIEntry* e, size_t n, uint64_t seed, size_t nbuckets,
+                             uint32_t* disp, size_t* order) {
+    HTIScratch sc;
+    bool ok = false;
+    sc.bucket_of = (size_t*)malloc(n * sizeof(size_t));
+    sc.start = (size_t*)calloc(nbuckets + 1, sizeof(size_t));
+    sc.members = (size_t*)malloc(n * sizeof(size_t));
+    sc.by_size = (size_t*)malloc(nbuckets * sizeof(size_t));
+    sc.taken = (unsigned char*)calloc(n, 1);
+    if (sc.bucket_of && sc.start && sc.members && sc.by_size && sc.taken) {
+        ok = _hti_group(e, n, seed, nbuckets, &sc)
+          && _hti_place(e, n, nbuckets, &sc, disp, order);
+    }
+    free(sc.bucket_of);
+    free(sc.start);
+    free(sc.members);
+    free(sc.by_size);
+    free(sc.taken);
+    return ok;
+}
+
+static bool _hti_build_perfect(HTIEntry* e, size_t n, HTImageHeader* hdr,
+                               uint64_t** slots_out, uint32_t** disp_out, size_t** order_out) {
+    size_t nbuckets = n / HTI_BUCKET_KEYS + 1;
+    int attempt;
+    if (n == 0 || nbuckets > 0xFFFFFFFFu) return false;
+    uint32_t* disp = (uint32_t*)malloc(nbuckets * sizeof(uint32_t));
+    size_t* order = (size_t*)malloc(n * sizeof(size_t));
+    uint64_t* slots = (uint64_t*)calloc(n, sizeof(uint64_t));
+    if (!disp || !order || !slots) {
+        free(disp);
+        free(order);
+        free(slots);
+        return false;
+    }
+    for (attempt = 0; attempt < HTI_MAX_RESEEDS; attempt++) {
+        uint64_t seed = _hti_mix(hdr->seed + (uint64_t)attempt);
+        if (_hti_try_perfect(e, n, seed, nbuckets, disp, order)) {
+            hdr->seed = seed;
+            hdr->nslots = n;
+            hdr->nbuckets = nbuckets;
+            *slots_out = slots;
+            *disp_out = disp;
+            *order_out = order;
+            return true;
+        }
+    }
+    free(disp);
+    free(order);
+    free(slots);
+    return false;
+}
+
+static bool _hti_write_entry(FILE* f, const HTIEntry* e) {
+    static const unsigned char zeros[8] = { 0 };
+    uint32_t lens[2];
+    lens[0] = (uint32_t)e->key_len;
+    lens[1] = (uint32_t)e->value_len;
+    size_t kpad = _hti_align8(e->key_len + 1) - e->key_len;
+    size_t vpad = _hti_align8(e->value_len + 1) - e->value_len;
+    return fwrite(lens, sizeof(lens), 1, f) == 1
+        && (e->key_len == 0 || fwrite(e->key, e->key_len, 1, f) == 1)
+        && fwrite(zeros, kpad, 1, f) == 1
+        && (e->value_len == 0 || fwrite(e->value, e->value_len, 1, f) == 1)
+        && fwrite(zeros, vpad, 1, f) == 1;
+}
+
+bool ht_image_write(const HashTable* ht, const char* path, HTImageMode mode,
+                    HTImageValueFn value_fn, void* userData) {
+    if (!ht || !path) return false;
+    if (mode != HT_IMAGE_OPEN_ADDRESSING && mode != HT_IMAGE_PERFECT) return false;
+
+    HTStats st;
+    ht_stats(ht, &st);
+    size_t n = st.count, i;
+    HTIEntry* e = (HTIEntry*)malloc((n ? n : 1) * sizeof(HTIEntry));
+    if (!e) return false;
+
+    /* collect entries and their value bytes */
+    HTIter it;
+    const char* key;
+    size_t key_len;
+    void* value;
+    i = 0;
+    ht_iter_init(ht, &it);
+    while (i < n && ht_iter_next(&it, &key, &key_len, &value)) {
+        e[i].key = key;
+        e[i].key_len = key_len;
+        if (value_fn) {
+            if (!value_fn(key, key_len, value, &e[i].value, &e[i].value_len, userData)) {
+                free(e);
+                return false;
+            }
+        } else {
+            e[i].value = value;
+            e[i].value_len = value ? strlen((const char*)value) : 0;
+        }
+        if (e[i].value_len > 0xFFFFFFFFu || (e[i].value_len > 0 && !e[i].value)) {
+            free(e);
+            return false;
+        }
+        i++;
+    }
+
+    HTImageHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, HTI_MAGIC, sizeof(HTI_MAGIC));
+    hdr.version = HTI_VERSION;
+    hdr.byte_order = HTI_BYTE_ORDER;
+    hdr.mode = (uint32_t)mode;
+    hdr.seed = HTI_SEED;
+    hdr.count = n;
+
+    uint64_t* slots = NULL;
+    uint32_t* disp = NULL;
+    size_t* order = NULL;   /* perfect: entry per slot */
+    bool built = mode == HT_IMAGE_PERFECT && n > 0
+        ? _hti_build_perfect(e, n, &hdr, &slots, &disp, &order)
+        : _hti_build_open(e, n, &hdr, &slots);
+    if (!built) {
+        free(e);
+        return false;
+    }
+    if (mode == HT_IMAGE_PERFECT && n == 0) hdr.mode = HT_IMAGE_OPEN_ADDRESSING;
+
+    /* offsets: header, displacements, slots, then the entries in slot order */
+    uint64_t off = _hti_align8(sizeof(HTImageHeader));
+    hdr.disp_off = off;
+    off += _hti_align8((size_t)hdr.nbuckets * sizeof(uint32_t));
+    hdr.slots_off = off;
+    off += hdr.nslots * sizeof(uint64_t);
+
+    if (mode == HT_IMAGE_PERFECT && n > 0) {
+        for (i = 0; i < n; i++) {
+            HTIEntry* x = &e[order[i]];
+            x->offset = off;
+            slots[i] = HTI_SLOT(off, x->hash);
+            off += _hti_entry_size(x->key_len, x->value_len);
+        }
+    } else {
+        size_t mask = (size_t)hdr.nslots - 1;
+        for (i = 0; i < n; i++) {
+            size_t pos = (size_t)e[i].hash & mask;
+            while (slots[pos]) pos = (pos + 1) & mask;
+            e[i].offset = off;
+            slots[pos] = HTI_SLOT(off, e[i].hash);
+            off += _hti_entry_size(e[i].key_len, e[i].value_len);
+        }
+    }
+    hdr.file_size = off;
+
+    bool ok = off < HTI_MAX_OFFSET;
+    FILE* f = ok ? fopen(path, "wb") : NULL;
+    if (f) {
+        static const unsigned char zeros[8] = { 0 };
+        size_t disp_pad = (size_t)(hdr.slots_off - hdr.disp_off) - (size_t)hdr.nbuckets * sizeof(uint32_t);
+        ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+          && fwrite(zeros, (size_t)hdr.disp_off - sizeof(hdr), 1, f) == (hdr.disp_off > sizeof(hdr) ? 1u : 0u)
+          && (hdr.nbuckets == 0 || fwrite(disp, sizeof(uint32_t), (size_t)hdr.nbuckets, f) == hdr.nbuckets)
+          && (disp_pad == 0 || fwrite(zeros, disp_pad, 1, f) == 1)
+          && fwrite(slots, sizeof(uint64_t), (size_t)hdr.nslots, f) == hdr.nslots;
+        for (i = 0; ok && i < n; i++) {
+            ok = _hti_write_entry(f, &e[order ? order[i] : i]);
+        }
+        if (fclose(f) != 0) ok = false;
+    } else {
+        ok = false;
+    }
+    free(slots);
+    free(disp);
+    free(order);
+    free(e);
+    return ok;
+}
+
+/* =========================================================
+ *             READER
+ * ========================================================= */
+
+static bool _hti_validate(HTImage* img) {
+    const HTImageHeader* h = (const HTImageHeader*)img->base;
+    if (img->size < sizeof(HTImageHeader)) return false;
+    if (memcmp(h->magic, HTI_MAGIC, sizeof(HTI_MAGIC)) != 0) return false;
+    if (h->version != HTI_VERSION || h->byte_order != HTI_BYTE_ORDER) return false;
+    if (h->file_size != img->size) return false;
+    if (h->nslots == 0 || h->disp_off % 8 || h->slots_off % 8) return false;
+    if (h->disp_off > img->size) return false;
+    if (h->nbuckets > (img->size - h->disp_off) / sizeof(uint32_t)) return false;
+    if (h->slots_off > img->size || h->nslots > (img->size - h->slots_off) / sizeof(uint64_t)) return false;
+    if (h->mode == HT_IMAGE_OPEN_ADDRESSING) {
+        if (h->nslots & (h->nslots - 1)) return false;
+    } else if (h->mode == HT_IMAGE_PERFECT) {
+        if (h->nslots != h->count || h->nbuckets == 0 || h->nbuckets > 0xFFFFFFFFu) return false;
+    } else {
+        return false;
+    }
+    img->hdr = h;
+    img->disp = (const uint32_t*)(const void*)(img->base + h->disp_off);
+    img->slots = (const uint64_t*)(const void*)(img->base + h->slots_off);
+    return true;
+}
+
+HTImage* ht_image_open(const char* path) {
+    if (!path) return NULL;
+    HTImage* img = (HTImage*)calloc(1, sizeof(HTImage));
+    if (!img) return NULL;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE) {
+        free(img);
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0
+        || (unsigned long long)size.QuadPart > (size_t)-1) {
+        CloseHandle(file);
+        free(img);
+        return NULL;
+    }
+    img->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);  /* the mapping keeps the file open */
+    if (!img->mapping) {
+        free(img);
+        return NULL;
+    }
+    img->base = (const unsigned char*)MapViewOfFile(img->mapping, FILE_MAP_READ, 0, 0, 0);
+    img->size = (size_t)size.QuadPart;
+    if (!img->base) {
+        CloseHandle(img->mapping);
+        free(img);
+        return NULL;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0) {
+        free(img);
+        return NULL;
+    }
+    if (fstat(fd, &sb) != 0 || sb.st_size <= 0 || (unsigned long long)sb.st_size > (size_t)-1) {
+        close(fd);
+        free(img);
+        return NULL;
+    }
+    void* p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  /* the mapping keeps the file referenced */
+    if (p == MAP_FAILED) {
+        free(img);
+        return NULL;
+    }
+    img->base = (const unsigned char*)p;
+    img->size = (size_t)sb.st_size;
+#endif
+
+    if (!_hti_validate(img)) {
+        ht_image_close(img);
+        return NULL;
+    }
+    return img;
+}
+
+void ht_image_close(HTImage* img) {
+    if (!img) return;
+#if defined(_WIN32)
+    if (img->base) UnmapViewOfFile(img->base);
+    if (img->mapping) CloseHandle(img->mapping);
+#else
+    if (img->base) munmap((void*)img->base, img->size);
+#endif
+    free(img);
+}
+
+/* Checks the entry a slot points at; returns its value or NULL. */
+static const void* _hti_match(const HTImage* img, uint64_t slot, const char* key,
+                              size_t key_len, size_t* len) {
+    uint64_t off = HTI_SLOT_OFF(slot);
+    if (off > img->size - 8) return NULL;
+    const unsigned char* p = img->base + off;
+    uint32_t lens[2];
+    memcpy(lens, p, sizeof(lens));
+    if (lens[0] != key_len) return NULL;
+    size_t need = _hti_entry_size(lens[0], lens[1]);
+    if (need > img->size - off) return NULL;  /* corrupt entry */
+    if (memcmp(p + 8, key, key_len) != 0) return NULL;
+    if (len) *len = lens[1];
+    return p + 8 + _hti_align8(key_len + 1);
+}
+
+const void* ht_image_get_n(const HTImage* img, const char* key, size_t key_len, size_t* len) {
+    if (!img || !key || key_len > 0xFFFFFFFFu || img->hdr->count == 0) return NULL;
+    const HTImageHeader* h = img->hdr;
+    uint64_t hash = ht_hash(key, key_len, h->seed);
+    uint64_t tag = HTI_TAG(hash);
+
+    if (h->mode == HT_IMAGE_PERFECT) {
+        uint32_t d = img->disp[_hti_bucket(hash, h->nbuckets)];
+        uint64_t s = img->slots[_hti_perfect_slot(hash, d, h->nslots)];
+        return (s & 0xFFFF) == tag ? _hti_match(img, s, key, key_len, len) : NULL;
+    }
+
+    size_t mask = (size_t)h->nslots - 1;
+    size_t pos = (size_t)hash & mask, probes;
+    for (probes = 0; probes < h->nslots; probes++) {
+        uint64_t s = img->slots[pos];
+        if (s == 0) return NULL;
+        if ((s & 0xFFFF) == tag) {
+            const void* v = _hti_match(img, s, key, key_len, len);
+            if (v) return v;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return NULL;
+}
+
+const void* ht_image_get(const HTImage* img, const char* key, size_t* len) {
+    if (!key) return NULL;
+    return ht_image_get_n(img, key, strlen(key), len);
+}
+
+size_t ht_image_count(const HTImage* img) {
+    return img ? (size_t)img->hdr->count : 0;
+}
+
+size_t ht_image_size(const HTImage* img) {
+    return img ? img->size : 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * ht_image.h
+ *
+ * Persistent, read-only images of a HashTable.
+ *
+ * ht_image_write() serializes a HashTable (string keys, values turned into
+ * byte blobs) into a compact file. All references inside the file are
+ * offsets from its start, so ht_image_open() just maps it into memory
+ * (mmap / MapViewOfFile) and lookups read straight from the mapping:
+ * opening costs O(1) regardless of the number of keys, and pages are only
+ * read from disk when a lookup touches them.
+ *
+ * Two layouts:
+ *   - HT_IMAGE_OPEN_ADDRESSING: power-of-two slot array at load <= 0.5,
+ *     linear probing. Fast to build.
+ *   - HT_IMAGE_PERFECT: minimal perfect hash (hash-and-displace): exactly
+ *     one slot per key plus ~1 byte of displacement data per key, and
+ *     every lookup inspects exactly one slot. Slower to build.
+ *
+ * The file uses the byte order and hash of the machine that wrote it;
+ * ht_image_open() rejects images from a machine of the other byte order.
+ *
+ * by Vladislav Tislenko aka keklick1337 (2025)
+ */
+
+#ifndef C99EXT_HT_IMAGE_H
+#define C99EXT_HT_IMAGE_H
+
+#include <stddef.h>  /* size_t */
+#include <stdbool.h> /* bool */
+#include "containers.h"
+
+typedef enum {
+    HT_IMAGE_OPEN_ADDRESSING = 0,
+    HT_IMAGE_PERFECT         = 1
+} HTImageMode;
+
+/*
+ * Turns the value stored under 'key' into the bytes written to the image:
+ * sets *data / *len and returns true, or returns false to abort the write.
+ * With a NULL callback every value is taken as a NUL-terminated string
+ * (NULL values become empty blobs).
+ */
+typedef bool (*HTImageValueFn)(const char* key, size_t key_len, void* value,
+                               const void** data, size_t* len, void* userData);
+
+/* Writes 'ht' to 'path' (overwriting it). Returns false on I/O or memory errors. */
+bool ht_image_write(const HashTable* ht, const char* path, HTImageMode mode,
+                    HTImageValueFn value_fn, void* userData);
+
+typedef struct HTImage HTImage;
+
+/* Maps an image file read-only. NULL if it cannot be opened or is not a valid image. */
+HTImage*    ht_image_open(const char* path);
+void        ht_image_close(HTImage* img);
+
+/*
+ * Returns a pointer to the value bytes of 'key' inside the mapping (8-byte
+ * aligned, followed by a '\0'), and its length in *len if 'len' is not
+ * NULL; NULL if the key is absent. Valid until ht_image_close.
+ */
+const void* ht_image_get(const HTImage* img, const char* key, size_t* len);
+const void* ht_image_get_n(const HTImage* img, const char* key, size_t key_len, size_t* len);
+
+size_t      ht_image_count(const HTImage* img);
+
+/* Size of the image in bytes */
+size_t      ht_image_size(const HTImage* img);
+
+#endif /* C99EXT_HT_IMAGE_H */
@@ -3,37 +3,14 @@
  * queue.c
  *
  * Implementation of a FIFO queue in C99 with cross-platform "thread-safe" usage.
- * We use 1 binary semaphore as a mutex, and 1 counting semaphore for items.
+ * We use 1 adaptive Mutex for the structure, and 1 counting semaphore for items.
  */
 
 #include "queue.h"
+#include "adv_mutex.h"
 #include "adv_semaphore.h"
 #include <stdlib.h>
 
-/*
- * We define a simple wrapper to represent "Mutex" as a binary semaphore.
- */
-typedef struct {
-    Semaphore sem;
-} Mutex;
-
-/*
- * Creates a binary semaphore with initial_count=1 => acts like a mutex
- */
-static void mutex_init(Mutex* m) {
-    // We ignore max_count or pass 1
-    Semaphore_init(&m->sem, 1, 1);
-}
-static void mutex_destroy(Mutex* m) {
-    Semaphore_destroy(&m->sem);
-}
-static void mutex_lock(Mutex* m) {
-    Semaphore_wait(&m->sem);
-}
-static void mutex_unlock(Mutex* m) {
-    Semaphore_post(&m->sem);
-}
-
 Queue* queue_create(void) {
     Queue* q = (Queue*)malloc(sizeof(Queue));
     if (!q) return NULL;
@@ -47,12 +24,12 @@ Queue* queue_create(void) {
         free(q);
         return NULL;
     }
-    mutex_init(m);
+    Mutex_init(m, MUTEX_DEFAULT_SPIN);
     q->mutex = m;
 
     Semaphore* item_sem = (Semaphore*)malloc(sizeof(Semaphore));
     if (!item_sem) {
-        mutex_destroy(m);
+        Mutex_destroy(m);
         free(m);
         free(q);
         return NULL;
@@ -74,7 +51,7 @@ void queue_destroy(Queue* q) {
         free(temp);
     }
 
-    // destroy semaphores
+    // destroy the semaphore and the lock
     if (q->items) {
         Semaphore* s = (Semaphore*)q->items;
         Semaphore_destroy(s);
@@ -82,7 +59,7 @@ void queue_destroy(Queue* q) {
     }
     if (q->mutex) {
         Mutex* m = (Mutex*)q->mutex;
-        mutex_destroy(m);
+        Mutex_destroy(m);
         free(m);
     }
     free(q);
@@ -98,7 +75,7 @@ void queue_push(Queue* q, void* data) {
 
     // lock
     Mutex* m = (Mutex*)q->mutex;
-    mutex_lock(m);
+    Mutex_lock(m);
 
     if (!q->tail) {
         q->head = node;
@@ -109,7 +86,7 @@ void queue_push(Queue* q, void* data) {
     }
     q->size++;
 
-    mutex_unlock(m);
+    Mutex_unlock(m);
 
     // signal that we have 1 more item
     Semaphore* s = (Semaphore*)q->items;
@@ -118,13 +95,15 @@ void queue_push(Queue* q, void* data) {
 
 void* queue_pop(Queue* q) {
     if (!q) return NULL;
-    // wait for an item to appear
+    // wait for an item to appear, unless the calling Thread is asked to stop first
     Semaphore* s = (Semaphore*)q->items;
-    Semaphore_wait(s);
+    if (!Semaphore_wait_interruptible(s)) {
+        return NULL;
+    }
 
     // lock
     Mutex* m = (Mutex*)q->mutex;
-    mutex_lock(m);
+    Mutex_lock(m);
 
     QueueNode* node = q->head;
     void* data = node->data;
@@ -135,7 +114,7 @@ void* queue_pop(Queue* q) {
     q->size--;
 
     free(node);
-    mutex_unlock(m);
+    Mutex_unlock(m);
 
     return data;
 }
@@ -143,17 +122,17 @@ void* queue_pop(Queue* q) {
 bool queue_is_empty(Queue* q) {
     if (!q) return true;
     Mutex* m = (Mutex*)q->mutex;
-    mutex_lock(m);
+    Mutex_lock(m);
     bool empty = (q->size == 0);
-    mutex_unlock(m);
+    Mutex_unlock(m);
     return empty;
 }
 
 size_t queue_size(Queue* q) {
     if (!q) return 0;
     Mutex* m = (Mutex*)q->mutex;
-    mutex_lock(m);
+    Mutex_lock(m);
     size_t s = q->size;
-    mutex_unlock(m);
+    Mutex_unlock(m);
     return s;
 }
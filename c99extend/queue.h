@@ -28,23 +28,11 @@ typedef struct {
     QueueNode*  tail;   // Pointer to the tail of the queue
     size_t      size;   // Current number of elements
 
-    // Instead of pthread_mutex_t, use our cross-platform approach:
-    // We'll do an adv_semaphore for usage or a small "Mutex" type.
-    // For simplicity, let's do a binary semaphore as a mutex:
-    // We'll do a counting semaphore of 1 => a "mutex"
-    // And another semaphore for "items" if we want blocking pop.
-    
-    // "mutex" protects the queue structure
-    // "items" is signaled when new items are available
+    // "mutex" (an adv_mutex.h Mutex) protects the queue structure.
+    // "items" is a counting Semaphore, signaled when new items are available.
     // "space" could also be used if we had a limit, but we skip that for now.
-
-    // We'll just use 1 "mutex" + 1 "items".
-    // For cross-platform "mutex", we can do adv_semaphore or a custom "adv_mutex".
-    // Let's do a binary sem for the queue lock, and a counting sem for items.
-    
-    // For demonstration, we do:
-    void* mutex;  // We'll store a pointer to a "binary semaphore" or "adv_mutex"
-    void* items;  // a counting semaphore for number of items
+    void* mutex;  // Mutex*
+    void* items;  // Semaphore*
 } Queue;
 
 /*
@@ -67,7 +55,8 @@ void queue_push(Queue* q, void* data);
 /*
  * Pops an element from the queue. If the queue is empty,
  * it blocks until an element becomes available.
- * Returns a pointer to the popped data.
+ * Returns a pointer to the popped data, or NULL if the calling Thread was
+ * asked to stop (Thread_request_stop) while waiting.
  */
 void* queue_pop(Queue* q);
 
@@ -6,6 +6,7 @@
 
 #include "thread_pool.h"
 #include "adv_thread.h"
+#include "adv_mutex.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -29,13 +30,8 @@ struct ThreadPool {
     TaskNode*   task_tail;
 
     // synchronization
-#ifdef _WIN32
-    CRITICAL_SECTION cs;
-    CONDITION_VARIABLE cond;
-#else
-    pthread_mutex_t  mutex;
-    pthread_cond_t   cond;
-#endif
+    Mutex       mutex;
+    CondVar     cond;
 };
 
 /* Forward declarations */
@@ -58,13 +54,8 @@ ThreadPool* thread_pool_create(size_t num_threads) {
     pool->task_head = NULL;
     pool->task_tail = NULL;
 
-#ifdef _WIN32
-    InitializeCriticalSection(&pool->cs);
-    InitializeConditionVariable(&pool->cond);
-#else
-    pthread_mutex_init(&pool->mutex, NULL);
-    pthread_cond_init(&pool->cond, NULL);
-#endif
+    Mutex_init(&pool->mutex, MUTEX_DEFAULT_SPIN);
+    CondVar_init(&pool->cond);
 
     // Create worker threads
     for (size_t i = 0; i < num_threads; i++) {
@@ -81,28 +72,16 @@ bool thread_pool_submit(ThreadPool* pool, ThreadPoolTaskFn fn, void* arg) {
     if (!pool || !fn) return false;
 
     // lock
-#ifdef _WIN32
-    EnterCriticalSection(&pool->cs);
-#else
-    pthread_mutex_lock(&pool->mutex);
-#endif
+    Mutex_lock(&pool->mutex);
 
     if (pool->shutdown_flag) {
-#ifdef _WIN32
-        LeaveCriticalSection(&pool->cs);
-#else
-        pthread_mutex_unlock(&pool->mutex);
-#endif
+        Mutex_unlock(&pool->mutex);
         return false;
     }
     // create new task
     TaskNode* node = (TaskNode*)malloc(sizeof(TaskNode));
     if (!node) {
-#ifdef _WIN32
-        LeaveCriticalSection(&pool->cs);
-#else
-        pthread_mutex_unlock(&pool->mutex);
-#endif
+        Mutex_unlock(&pool->mutex);
         return false;
     }
     node->fn = fn;
@@ -119,13 +98,8 @@ bool thread_pool_submit(ThreadPool* pool, ThreadPoolTaskFn fn, void* arg) {
     }
 
     // notify a worker
-#ifdef _WIN32
-    WakeConditionVariable(&pool->cond);
-    LeaveCriticalSection(&pool->cs);
-#else
-    pthread_cond_signal(&pool->cond);
-    pthread_mutex_unlock(&pool->mutex);
-#endif
+    CondVar_signal(&pool->cond);
+    Mutex_unlock(&pool->mutex);
 
     return true;
 }
@@ -134,17 +108,10 @@ void thread_pool_destroy(ThreadPool* pool) {
     if (!pool) return;
 
     // signal shutdown
-#ifdef _WIN32
-    EnterCriticalSection(&pool->cs);
+    Mutex_lock(&pool->mutex);
     pool->shutdown_flag = true;
-    WakeAllConditionVariable(&pool->cond);
-    LeaveCriticalSection(&pool->cs);
-#else
-    pthread_mutex_lock(&pool->mutex);
-    pool->shutdown_flag = true;
-    pthread_cond_broadcast(&pool->cond);
-    pthread_mutex_unlock(&pool->mutex);
-#endif
+    CondVar_broadcast(&pool->cond);
+    Mutex_unlock(&pool->mutex);
 
     // join all
     for (size_t i = 0; i < pool->num_threads; i++) {
@@ -161,12 +128,8 @@ void thread_pool_destroy(ThreadPool* pool) {
 
     free(pool->workers);
 
-#ifdef _WIN32
-    DeleteCriticalSection(&pool->cs);
-#else
-    pthread_mutex_destroy(&pool->mutex);
-    pthread_cond_destroy(&pool->cond);
-#endif
+    Mutex_destroy(&pool->mutex);
+    CondVar_destroy(&pool->cond);
 
     free(pool);
 }
@@ -177,28 +140,12 @@ static void* thread_pool_worker(void* arg) {
 
     for (;;) {
         // lock
-#ifdef _WIN32
-        EnterCriticalSection(&pool->cs);
-        while (!pool->shutdown_flag && pool->task_head == NULL) {
-            SleepConditionVariableCS(&pool->cond, &pool->cs, INFINITE);
-        }
-        if (pool->shutdown_flag && pool->task_head == NULL) {
-            LeaveCriticalSection(&pool->cs);
-            break;
-        }
-        TaskNode* task = pool->task_head;
-        pool->task_head = task->next;
-        if (!pool->task_head) {
-            pool->task_tail = NULL;
-        }
-        LeaveCriticalSection(&pool->cs);
-#else
-        pthread_mutex_lock(&pool->mutex);
+        Mutex_lock(&pool->mutex);
         while (!pool->shutdown_flag && pool->task_head == NULL) {
-            pthread_cond_wait(&pool->cond, &pool->mutex);
+            CondVar_wait(&pool->cond, &pool->mutex);
         }
         if (pool->shutdown_flag && pool->task_head == NULL) {
-            pthread_mutex_unlock(&pool->mutex);
+            Mutex_unlock(&pool->mutex);
             break;
         }
         TaskNode* task = pool->task_head;
@@ -206,8 +153,7 @@ static void* thread_pool_worker(void* arg) {
         if (!pool->task_head) {
             pool->task_tail = NULL;
         }
-        pthread_mutex_unlock(&pool->mutex);
-#endif
+        Mutex_unlock(&pool->mutex);
 
         // run the task
         task->fn(task->arg);
@@ -0,0 +1,235 @@
+/*
+ * typed_map.h
+ *
+ * Type-specialized hash maps generated by a macro (header only, C99).
+ *
+ * HashTable maps 'const char*' to 'void*'; integer or struct keys have to be
+ * boxed into strings or pointers, and values live behind a 'void*'.
+ * TYPED_MAP_DEFINE instead generates a map for one key type and one value
+ * type: keys and values are stored inline in their own arrays, and the
+ * hash / equality functions are called directly from static inline code,
+ * so the compiler can inline them.
+ *
+ *   static inline size_t u64_hash(const uint64_t* k) { return (size_t)*k; }
+ *   static inline bool   u64_eq(const uint64_t* a, const uint64_t* b) { return *a == *b; }
+ *   TYPED_MAP_DEFINE(U64Map, uint64_t, double, u64_hash, u64_eq)
+ *
+ *   U64Map* m = U64Map_create(0);
+ *   U64Map_put(m, 42, 1.5);
+ *   double* v = U64Map_find(m, 42);
+ *
+ * HASH(const KeyT*) returns a size_t (it is mixed afterwards, so even the
+ * identity is fine for integers); EQ(const KeyT*, const KeyT*) returns bool.
+ * Both may be functions or function-like macros.
+ *
+ * Layout: open addressing with linear probing over a power-of-two table,
+ * one metadata byte per slot (0 = empty, 0x80 | 7-bit hash tag = full), so
+ * a probe compares keys only on a tag match. Removal is backward-shift
+ * deletion (no tombstones). The table doubles once it is 3/4 full.
+ *
+ * by Vladislav Tislenko aka keklick1337 (2025)
+ */
+
+#ifndef TYPED_MAP_H
+#define TYPED_MAP_H
+
+#include <stddef.h>  /* size_t */
+#include <stdbool.h> /* bool */
+#include <stdint.h>  /* uint64_t */
+#include <stdlib.h>  /* malloc, calloc, free */
+
+/* splitmix64 finalizer: spreads any user hash over all 64 bits */
+static inline uint64_t tmap_mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+#define TMAP_EMPTY        0x00
+#define TMAP_TAG(h)       ((unsigned char)(0x80 | ((h) >> 57)))
+#define TMAP_MIN_CAPACITY 16
+
+/*
+ * Generates:
+ *   Name*  Name_create(size_t capacity);   capacity 0 = default
+ *   void   Name_destroy(Name* m);
+ *   bool   Name_put(Name* m, KeyT key, ValT value);          insert or assign; false if out of memory
+ *   ValT*  Name_find(Name* m, KeyT key);                     pointer to the stored value or NULL
+ *                                                            (valid until the next put / remove)
+ *   bool   Name_get(const Name* m, KeyT key, ValT* out);     copies the value out; false if absent
+ *   bool   Name_remove(Name* m, KeyT key, ValT* out);        'out' may be NULL; false if absent
+ *   size_t Name_size(const Name* m);
+ *   bool   Name_next(const Name* m, size_t* pos, KeyT* key, ValT* value);
+ *          iteration: start with *pos = 0, call until it returns false
+ *          (key / value may be NULL; the map must not change meanwhile)
+ */
+#define TYPED_MAP_DEFINE(Name, KeyT, ValT, HASH, EQ)                                    \
+                                                                                        \
+typedef struct Name {                                                                   \
+    unsigned char* meta;      /* one byte per slot */                                   \
+    KeyT*          keys;                                                                \
+    ValT*          vals;                                                                \
+    size_t         capacity;  /* power of two */                                        \
+    size_t         count;                                                               \
+} Name;                                                                                 \
+                                                                                        \
+static inline uint64_t Name##_hash_(const KeyT* key) {                                  \
+    return tmap_mix((uint64_t)HASH(key));                                               \
+}                                                                                       \
+                                                                                        \
+static inline bool Name##_alloc_(Name* m, size_t capacity) {                            \
+    m->meta = (unsigned char*)calloc(capacity, 1);                                      \
+    m->keys = (KeyT*)malloc(capacity * sizeof(KeyT));                                   \
+    m->vals = (ValT*)malloc(capacity * sizeof(ValT));                                   \
+    if (!m->meta || !m->keys || !m->vals) {                                             \
+        free(m->meta);                                                                  \
+        free(m->keys);                                                                  \
+        free(m->vals);                                                                  \
+        return false;                                                                   \
+    }                                                                                   \
+    m->capacity = capacity;                                                             \
+    return true;                                                                        \
+}                                                                                       \
+                                                                                        \
+static inline Name* Name##_create(size_t capacity) {                                    \
+    size_t cap = TMAP_MIN_CAPACITY;                                                     \
+    while (cap < capacity) {                                                            \
+        if (cap > ((size_t)-1 >> 2) / (sizeof(KeyT) + sizeof(ValT) + 1)) return NULL;  \
+        cap <<= 1;                                                                      \
+    }                                                                                   \
+    Name* m = (Name*)malloc(sizeof(Name));                                              \
+    if (!m) return NULL;                                                                \
+    if (!Name##_alloc_(m, cap)) {                                                       \
+        free(m);                                                                        \
+        return NULL;                                                                    \
+    }                                                                                   \
+    m->count = 0;                                                                       \
+    return m;                                                                           \
+}                                                                                       \
+                                                                                        \
+static inline void Name##_destroy(Name* m) {                                            \
+    if (!m) return;                                                                     \
+    free(m->meta);                                                                      \
+    free(m->keys);                                                                      \
+    free(m->vals);                                                                      \
+    free(m);                                                                            \
+}                                                                                       \
+                                                                                        \
+static inline size_t Name##_size(const Name* m) { return m ? m->count : 0; }            \
+                                                                                        \
+/* Slot of 'key' or (size_t)-1 */                                                       \
+static inline size_t Name##_slot_(const Name* m, const KeyT* key, uint64_t h) {         \
+    size_t mask = m->capacity - 1;                                                      \
+    size_t i = (size_t)h & mask;                                                        \
+    unsigned char tag = TMAP_TAG(h);                                                    \
+    for (;;) {                                                                          \
+        unsigned char c = m->meta[i];                                                   \
+        if (c == TMAP_EMPTY) return (size_t)-1;                                         \
+        if (c == tag && EQ(&m->keys[i], key)) return i;                                 \
+        i = (i + 1) & mask;                                                             \
+    }                                                                                   \
+}                                                                                       \
+                                                                                        \
+/* Places a key known to be absent; there is always a free slot */                      \
+static inline void Name##_place_(Name* m, const KeyT* key, const ValT* value,           \
+                                 uint64_t h) {                                          \
+    size_t mask = m->capacity - 1;                                                      \
+    size_t i = (size_t)h & mask;                                                        \
+    while (m->meta[i] != TMAP_EMPTY) i = (i + 1) & mask;                                \
+    m->meta[i] = TMAP_TAG(h);                                                           \
+    m->keys[i] = *key;                                                                  \
+    m->vals[i] = *value;                                                                \
+}                                                                                       \
+                                                                                        \
+static inline bool Name##_grow_(Name* m) {                                              \
+    Name old = *m;                                                                      \
+    size_t i;                                                                           \
+    if (old.capacity > ((size_t)-1 >> 3) / (sizeof(KeyT) + sizeof(ValT) + 1)) {         \
+        return false;                                                                   \
+    }                                                                                   \
+    if (!Name##_alloc_(m, old.capacity * 2)) {                                          \
+        *m = old;                                                                       \
+        return false;                                                                   \
+    }                                                                                   \
+    for (i = 0; i < old.capacity; i++) {                                                \
+        if (old.meta[i] != TMAP_EMPTY) {                                                \
+            Name##_place_(m, &old.keys[i], &old.vals[i], Name##_hash_(&old.keys[i]));   \
+        }                                                                               \
+    }                                                                                   \
+    free(old.meta);                                                                     \
+    free(old.keys);                                                                     \
+    free(old.vals);                                                                     \
+    return true;                                                                        \
+}                                                                                       \
+                                                                                        \
+static inline bool Name##_put(Name* m, KeyT key, ValT value) {                          \
+    if (!m) return false;                                                               \
+    uint64_t h = Name##_hash_(&key);                                                    \
+    size_t i = Name##_slot_(m, &key, h);                                                \
+    if (i != (size_t)-1) {                                                              \
+        m->vals[i] = value;                                                             \
+        return true;                                                                    \
+    }                                                                                   \
+    if ((m->count + 1) * 4 > m->capacity * 3 && !Name##_grow_(m)                        \
+        && m->count + 1 >= m->capacity) {                                               \
+        return false; /* out of memory, and one slot stays empty so probes end */       \
+    }                                                                                   \
+    Name##_place_(m, &key, &value, h);                                                  \
+    m->count++;                                                                         \
+    return true;                                                                        \
+}                                                                                       \
+                                                                                        \
+static inline ValT* Name##_find(Name* m, KeyT key) {                                    \
+    if (!m) return NULL;                                                                \
+    size_t i = Name##_slot_(m, &key, Name##_hash_(&key));                               \
+    return i == (size_t)-1 ? NULL : &m->vals[i];                                        \
+}                                                                                       \
+                                                                                        \
+static inline bool Name##_get(const Name* m, KeyT key, ValT* out) {                     \
+    if (!m) return false;                                                               \
+    size_t i = Name##_slot_(m, &key, Name##_hash_(&key));                               \
+    if (i == (size_t)-1) return false;                                                  \
+    if (out) *out = m->vals[i];                                                         \
+    return true;                                                                        \
+}                                                                                       \
+                                                                                        \
+static inline bool Name##_remove(Name* m, KeyT key, ValT* out) {                        \
+    if (!m) return false;                                                               \
+    size_t hole = Name##_slot_(m, &key, Name##_hash_(&key));                            \
+    if (hole == (size_t)-1) return false;                                               \
+    if (out) *out = m->vals[hole];                                                      \
+    /* backward shift: pull later chain entries back unless the hole precedes home */   \
+    size_t mask = m->capacity - 1;                                                      \
+    size_t i = (hole + 1) & mask;                                                       \
+    while (m->meta[i] != TMAP_EMPTY) {                                                  \
+        size_t home = (size_t)Name##_hash_(&m->keys[i]) & mask;                         \
+        if (((i - hole) & mask) <= ((i - home) & mask)) {                               \
+            m->meta[hole] = m->meta[i];                                                 \
+            m->keys[hole] = m->keys[i];                                                 \
+            m->vals[hole] = m->vals[i];                                                 \
+            hole = i;                                                                   \
+        }                                                                               \
+        i = (i + 1) & mask;                                                             \
+    }                                                                                   \
+    m->meta[hole] = TMAP_EMPTY;                                                         \
+    m->count--;                                                                         \
+    return true;                                                                        \
+}                                                                                       \
+                                                                                        \
+static inline bool Name##_next(const Name* m, size_t* pos, KeyT* key, ValT* value) {    \
+    if (!m || !pos) return false;                                                       \
+    while (*pos < m->capacity) {                                                        \
+        size_t i = (*pos)++;                                                            \
+        if (m->meta[i] != TMAP_EMPTY) {                                                 \
+            if (key) *key = m->keys[i];                                                 \
+            if (value) *value = m->vals[i];                                             \
+            return true;                                                                \
+        }                                                                               \
+    }                                                                                   \
+    return false;                                                                       \
+}
+
+#endif /* TYPED_MAP_H */
@@ -4,6 +4,9 @@
  * Minimal test for the extended containers:
  *   - Dynamic Array (with map/filter/reduce)
  *   - Hash Table
+ *   - Typed hash maps (TYPED_MAP_DEFINE)
+ *   - Persistent hash table images (ht_image)
+ *   - Generic HashSet (linear probing and Robin Hood, set algebra, iteration)
  *   - Red-Black Tree
  *
  * by Vladislav Tislenko aka keklick1337 (2025)
@@ -13,6 +16,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include "containers.h"
+#include "typed_map.h"
+#include "ht_image.h"
+#include "thread_pool.h"
 
 /* For testing map/filter/reduce, let's define some sample functions: */
 
@@ -83,6 +89,16 @@ static bool long_eq(const void* a, const void* b) {
     return (aa == bb);
 }
 
+/* Typed maps: an integer-keyed one and a struct-keyed one */
+static inline size_t int_key_hash(const int* k) { return (size_t)*k; }
+static inline bool   int_key_eq(const int* a, const int* b) { return *a == *b; }
+TYPED_MAP_DEFINE(IntDoubleMap, int, double, int_key_hash, int_key_eq)
+
+typedef struct { int x, y; } Point;
+static inline size_t point_hash(const Point* p) { return (size_t)p->x * 31u + (size_t)p->y; }
+static inline bool   point_eq(const Point* a, const Point* b) { return a->x == b->x && a->y == b->y; }
+TYPED_MAP_DEFINE(PointMap, Point, const char*, point_hash, point_eq)
+
 /* A helper function to print all elements in a set (assuming they're int*) */
 static void print_int_elem(void* elem, void* userData) {
     (void)userData;
@@ -97,6 +113,20 @@ static void print_str_elem(void* elem, void* userData) {
     printf("'%s' ", s);
 }
 
+/* Stoppable visitor: sums int elements, stops once the sum reaches a limit */
+typedef struct {
+    long sum;
+    long limit;
+    long visited;
+} SumUntil;
+
+static bool sum_until(void* elem, void* userData) {
+    SumUntil* su = (SumUntil*)userData;
+    su->sum += *(int*)elem;
+    su->visited++;
+    return su->sum < su->limit;
+}
+
 int main(void) {
     printf("=== containers_test ===\n\n");
 
@@ -171,6 +201,206 @@ int main(void) {
     printf("banana -> %s\n", (char*)ht_get(ht, "banana")); /* should be NULL */
     ht_destroy(ht);
 
+    /* Growth: 1000 keys into a table created with 8 slots */
+    HashTable* big = ht_create(8);
+    static int values[1000];
+    char keybuf[32];
+    HTStats st;
+    int k, missing = 0;
+    for (k = 0; k < 1000; k++) {
+        values[k] = k;
+        snprintf(keybuf, sizeof(keybuf), "key-%d", k);
+        ht_insert(big, keybuf, &values[k]);
+        if (k == 500) {
+            ht_stats(big, &st);
+            printf("After 501 inserts: capacity %zu, rehashing %d\n", st.capacity, (int)st.rehashing);
+        }
+    }
+    for (k = 0; k < 1000; k++) {
+        snprintf(keybuf, sizeof(keybuf), "key-%d", k);
+        int* v = (int*)ht_get(big, keybuf);
+        if (!v || *v != k) missing++;
+    }
+    ht_stats(big, &st);
+    printf("After 1000 inserts: count %zu, capacity %zu, load %.2f, avg probe %.2f, missing %d\n",
+           st.count, st.capacity, st.load_factor, st.avg_probe, missing);
+
+    /* Churn: remove the odd keys; every even key must still be reachable */
+    int wrong = 0;
+    for (k = 1; k < 1000; k += 2) {
+        snprintf(keybuf, sizeof(keybuf), "key-%d", k);
+        if (ht_remove(big, keybuf) != &values[k]) wrong++;
+    }
+    for (k = 0; k < 1000; k++) {
+        snprintf(keybuf, sizeof(keybuf), "key-%d", k);
+        int* v = (int*)ht_get(big, keybuf);
+        if ((k % 2 == 0) != (v == &values[k])) wrong++;
+    }
+    ht_stats(big, &st);
+    printf("After removing odd keys: count %zu, wrong results %d\n", st.count, wrong);
+
+    /* Explicit-length keys: slices of a larger buffer, no NUL needed */
+    const char* line = "key-10,key-11,key-12";
+    printf("slice 'key-10' -> %d, slice 'key-11' -> %s, prefix 'key-1' -> %s\n",
+           *(int*)ht_get_n(big, line, 6),
+           ht_get_n(big, line + 7, 6) ? "found" : "NULL",
+           ht_get_n(big, line, 5) ? "found" : "NULL");
+    ht_insert_n(big, line + 14, 6, &values[12]);
+    printf("ht_insert_n slice then ht_get(\"key-12\") -> %d\n", *(int*)ht_get(big, "key-12"));
+    ht_destroy(big);
+
+    /* Long keys live in the key arena; removing most of them compacts it */
+    HashTable* lk = ht_create(16);
+    static int lvalues[5000];
+    HTStats before;
+    wrong = 0;
+    for (k = 0; k < 5000; k++) {
+        lvalues[k] = k;
+        snprintf(keybuf, sizeof(keybuf), "a-rather-long-key-%d", k);
+        ht_insert(lk, keybuf, &lvalues[k]);
+    }
+    ht_stats(lk, &before);
+    for (k = 0; k < 5000; k++) {
+        if (k % 10 == 0) continue;
+        snprintf(keybuf, sizeof(keybuf), "a-rather-long-key-%d", k);
+        if (ht_remove(lk, keybuf) != &lvalues[k]) wrong++;
+    }
+    for (k = 0; k < 5000; k++) {
+        snprintf(keybuf, sizeof(keybuf), "a-rather-long-key-%d", k);
+        if ((k % 10 == 0) != (ht_get(lk, keybuf) == &lvalues[k])) wrong++;
+    }
+    ht_stats(lk, &st);
+    printf("Long keys: count %zu, wrong results %d, memory shrank after removals: %d\n",
+           st.count, wrong, (int)(st.memory_bytes < before.memory_bytes));
+    ht_destroy(lk);
+
+    /* Reserve, bulk insert (with a duplicate key) and iteration */
+    static char bulk_keys[1000][16];
+    const char* bulk_ptrs[1001];
+    void* bulk_vals[1001];
+    for (k = 0; k < 1000; k++) {
+        snprintf(bulk_keys[k], sizeof(bulk_keys[k]), "bulk-%d", k);
+        bulk_ptrs[k] = bulk_keys[k];
+        bulk_vals[k] = &values[k];
+    }
+    bulk_ptrs[1000] = "bulk-0";          /* later duplicate wins, as with ht_insert */
+    bulk_vals[1000] = &values[999];
+    HashTable* bt = ht_create(16);
+    ht_reserve(bt, 1000);
+    ht_stats(bt, &st);
+    printf("After ht_reserve(1000): capacity %zu\n", st.capacity);
+    bool bulk_ok = ht_insert_bulk(bt, bulk_ptrs, bulk_vals, 1001);
+    HTIter it;
+    const char* ikey;
+    size_t ilen;
+    void* ival;
+    long visited = 0, sum = 0;
+    wrong = 0;
+    ht_iter_init(bt, &it);
+    while (ht_iter_next(&it, &ikey, &ilen, &ival)) {
+        visited++;
+        sum += *(int*)ival;
+        if (strlen(ikey) != ilen || ht_get(bt, ikey) != ival) wrong++;
+    }
+    ht_stats(bt, &st);
+    printf("Bulk insert ok %d: count %zu, capacity %zu, iterated %ld, sum %ld, wrong %d\n",
+           (int)bulk_ok, st.count, st.capacity, visited, sum, wrong);
+
+    /* Batched lookup: hits, a miss and a NULL key mixed in one batch */
+    const char* look[4] = { "bulk-7", "bulk-missing", NULL, "bulk-0" };
+    void* got[4];
+    size_t hits = ht_get_batch(bt, look, 4, got);
+    printf("ht_get_batch: %zu found, bulk-7 -> %d, missing -> %s, NULL key -> %s, bulk-0 -> %d\n",
+           hits, got[0] ? *(int*)got[0] : -1, got[1] ? "found" : "NULL", got[2] ? "found" : "NULL",
+           got[3] ? *(int*)got[3] : -1);
+    ht_destroy(bt);
+
+    /* A NULL key in the middle of a batch: the keys before it are in, the rest are not */
+    bulk_ptrs[20] = NULL;
+    HashTable* nt = ht_create(16);
+    bool null_ok = ht_insert_bulk(nt, bulk_ptrs, bulk_vals, 1000);
+    int before_in = 0, after_in = 0;
+    for (k = 0; k < 1000; k++) {
+        if (k == 20) continue;
+        if (ht_get(nt, bulk_keys[k]) == &values[k]) {
+            if (k < 20) before_in++;
+            else after_in++;
+        }
+    }
+    ht_stats(nt, &st);
+    printf("Bulk insert with NULL key #20 ok %d: count %zu, before it in %d, after it in %d\n",
+           (int)null_ok, st.count, before_in, after_in);
+    bulk_ptrs[20] = bulk_keys[20];
+    ht_destroy(nt);
+
+    printf("\n--- Testing TYPED_MAP_DEFINE ---\n");
+    IntDoubleMap* idm = IntDoubleMap_create(0);
+    wrong = 0;
+    for (k = 0; k < 10000; k++) {
+        IntDoubleMap_put(idm, k, k * 0.5);
+    }
+    IntDoubleMap_put(idm, 7, -1.0);              /* assign */
+    *IntDoubleMap_find(idm, 8) += 100.0;         /* values are stored inline */
+    for (k = 0; k < 10000; k += 2) {
+        if (k != 8 && !IntDoubleMap_remove(idm, k, NULL)) wrong++;
+    }
+    for (k = 0; k < 10000; k++) {
+        double d = 0.0;
+        bool present = IntDoubleMap_get(idm, k, &d);
+        double expect = k == 7 ? -1.0 : k == 8 ? 104.0 : k * 0.5;
+        if (present != (k % 2 == 1 || k == 8) || (present && d != expect)) wrong++;
+    }
+    size_t tpos = 0;
+    int tkey;
+    long tcount = 0;
+    while (IntDoubleMap_next(idm, &tpos, &tkey, NULL)) tcount++;
+    printf("IntDoubleMap: size %zu, iterated %ld, wrong %d\n", IntDoubleMap_size(idm), tcount, wrong);
+    IntDoubleMap_destroy(idm);
+
+    PointMap* pm = PointMap_create(4);
+    Point p1 = { 1, 2 }, p2 = { 2, 1 }, p3 = { 1, 2 };
+    const char* pv = NULL;
+    PointMap_put(pm, p1, "one-two");
+    PointMap_put(pm, p2, "two-one");
+    PointMap_get(pm, p3, &pv);
+    size_t psize = PointMap_size(pm);
+    bool premoved = PointMap_remove(pm, p2, NULL);
+    printf("PointMap: {1,2} -> %s, size %zu, remove {2,1} -> %d, {2,1} present -> %d\n",
+           pv ? pv : "(null)", psize, (int)premoved, (int)PointMap_get(pm, p2, NULL));
+    PointMap_destroy(pm);
+
+    printf("\n--- Testing ht_image ---\n");
+    HashTable* src = ht_create(16);
+    static char img_keys[1000][16];
+    static char img_vals[1000][16];
+    for (k = 0; k < 1000; k++) {
+        snprintf(img_keys[k], sizeof(img_keys[k]), "img-%d", k);
+        snprintf(img_vals[k], sizeof(img_vals[k]), "v%d", k * 3);
+        ht_insert(src, img_keys[k], img_vals[k]);
+    }
+    ht_insert_n(src, "bin\0key", 7, img_vals[1]);   /* binary keys survive too */
+    int mode;
+    for (mode = HT_IMAGE_OPEN_ADDRESSING; mode <= HT_IMAGE_PERFECT; mode++) {
+        const char* img_path = "containers_test.htimg";
+        bool written = ht_image_write(src, img_path, (HTImageMode)mode, NULL, NULL);
+        HTImage* img = ht_image_open(img_path);
+        size_t vlen = 0;
+        wrong = 0;
+        for (k = 0; img && k < 1000; k++) {
+            const char* v = (const char*)ht_image_get(img, img_keys[k], &vlen);
+            if (!v || strcmp(v, img_vals[k]) != 0 || vlen != strlen(img_vals[k])) wrong++;
+            snprintf(keybuf, sizeof(keybuf), "absent-%d", k);
+            if (ht_image_get(img, keybuf, NULL)) wrong++;
+        }
+        const char* bv = img ? (const char*)ht_image_get_n(img, "bin\0key", 7, NULL) : NULL;
+        printf("%s image: written %d, opened %d, count %zu, bin key -> %s, wrong %d\n",
+               mode == HT_IMAGE_PERFECT ? "Perfect" : "Open-addressing", (int)written,
+               (int)(img != NULL), ht_image_count(img), bv ? bv : "(null)", wrong);
+        ht_image_close(img);
+        remove(img_path);
+    }
+    ht_destroy(src);
+
     printf("\n--- Testing RBTree ---\n");
     RBTree* tree = rbt_create();
     rbt_insert(tree, 10, "val10");
@@ -266,6 +496,176 @@ int main(void) {
 
     hs_destroy(longSet);
 
+    /* 4) Linear probing vs Robin Hood under insert/remove churn */
+    static int churn[40000];
+    int probing;
+    for (k = 0; k < 40000; k++) churn[k] = k;
+    for (probing = HS_LINEAR_PROBING; probing <= HS_ROBIN_HOOD; probing++) {
+        HashSet* cs = hs_create_ex(16, int_hash, int_eq, (HSProbing)probing, 0.0f);
+        HSStats hst;
+        wrong = 0;
+        for (k = 0; k < 10000; k++) hs_insert(cs, &churn[k]);
+        /* slide a window of 10000 live elements over 0..39999 */
+        for (k = 0; k < 30000; k++) {
+            if (!hs_remove(cs, &churn[k])) wrong++;
+            if (!hs_insert(cs, &churn[k + 10000])) wrong++;
+        }
+        for (k = 0; k < 40000; k++) {
+            if (hs_contains(cs, &churn[k]) != (k >= 30000)) wrong++;
+        }
+        hs_stats(cs, &hst);
+        size_t hist_total = 0;
+        for (i = 0; i < HS_PROBE_HIST_BUCKETS; i++) hist_total += hst.probe_hist[i];
+        printf("%s churn: size %zu, histogram total %zu, max probe <= 32: %d, wrong %d\n",
+               probing == HS_ROBIN_HOOD ? "Robin Hood" : "Linear", hst.size, hist_total,
+               (int)(hst.max_probe <= 32), wrong);
+        hs_destroy(cs);
+    }
+
+    /* 5) Tombstones, compaction, shrink_to_fit and a custom load factor */
+    HashSet* ts = hs_create_ex(16, int_hash, int_eq, HS_LINEAR_PROBING, 0.5f);
+    HSStats tst;
+    wrong = 0;
+    for (k = 0; k < 20000; k++) hs_insert(ts, &churn[k]);
+    hs_stats(ts, &tst);
+    printf("Load factor 0.5: size %zu, load <= 0.5: %d\n", tst.size, (int)(tst.load_factor <= 0.5));
+    for (k = 100; k < 20000; k++) hs_remove(ts, &churn[k]);
+    size_t grown_cap = tst.capacity;
+    /* churn on the small remainder: compaction keeps the capacity, tombstones stay bounded */
+    for (k = 20000; k < 40000; k++) {
+        hs_insert(ts, &churn[k]);
+        hs_remove(ts, &churn[k]);
+    }
+    hs_stats(ts, &tst);
+    printf("After removals + churn: size %zu, same capacity %d, tombstones bounded %d\n",
+           tst.size, (int)(tst.capacity == grown_cap),
+           (int)(tst.size + tst.tombstones <= tst.capacity / 2 + 1));
+    bool shrunk = hs_shrink_to_fit(ts);
+    hs_stats(ts, &tst);
+    for (k = 0; k < 40000; k++) {
+        if (hs_contains(ts, &churn[k]) != (k < 100)) wrong++;
+    }
+    printf("hs_shrink_to_fit %d: size %zu, capacity %zu, tombstones %zu, wrong %d\n",
+           (int)shrunk, tst.size, tst.capacity, tst.tombstones, wrong);
+    size_t shrunk_cap = tst.capacity;
+    hs_insert(ts, &churn[100]);
+    printf("Insert after shrink keeps the capacity: %d\n", (int)(hs_capacity(ts) == shrunk_cap));
+    hs_destroy(ts);
+    HashSet* bad = hs_create_ex(16, int_hash, int_eq, HS_LINEAR_PROBING, 1.5f);
+    printf("hs_create_ex with load factor 1.5 -> %s\n", bad ? "set" : "NULL");
+    hs_destroy(bad);
+
+    /* 6) Set algebra, sequential and split across a ThreadPool */
+    ThreadPool* pool = thread_pool_create(4);
+    int run;
+    for (run = 0; run < 2; run++) {
+        ThreadPool* p = run ? pool : NULL;
+        HashSet* sa = hs_create(16, int_hash, int_eq);
+        HashSet* sb = hs_create_ex(16, int_hash, int_eq, HS_ROBIN_HOOD, 0.0f);
+        for (k = 0; k < 30000; k++) hs_insert(sa, &churn[k]);        /* a = [0, 30000) */
+        for (k = 10000; k < 40000; k++) hs_insert(sb, &churn[k]);    /* b = [10000, 40000) */
+        HashSet* su = hs_union(sa, sb, p);
+        HashSet* si = hs_intersect(sa, sb, p);
+        HashSet* sd = hs_difference(sa, sb, p);
+        wrong = 0;
+        for (k = 0; k < 40000; k++) {
+            if (!hs_contains(su, &churn[k])) wrong++;
+            if (hs_contains(si, &churn[k]) != (k >= 10000 && k < 30000)) wrong++;
+            if (hs_contains(sd, &churn[k]) != (k < 10000)) wrong++;
+        }
+        bool sub1 = hs_is_subset(si, sa, p);
+        bool sub2 = hs_is_subset(sa, sb, p);
+        HSStats su_st, si_st, sd_st;
+        hs_stats(su, &su_st);
+        hs_stats(si, &si_st);
+        hs_stats(sd, &sd_st);
+        printf("%s: union %zu, intersection %zu, difference %zu, a&b <= a %d, a <= b %d, wrong %d\n",
+               p ? "Set algebra (pool)" : "Set algebra", su_st.size, si_st.size, sd_st.size,
+               (int)sub1, (int)sub2, wrong);
+        /* in place: a = ((a | b) & (a \ b)) \ [0, 5000) = [5000, 10000) */
+        HashSet* first = hs_create(16, int_hash, int_eq);
+        for (k = 0; k < 5000; k++) hs_insert(first, &churn[k]);
+        bool ok1 = hs_union_inplace(sa, sb, p);
+        bool ok2 = hs_intersect_inplace(sa, sd, p);
+        bool ok3 = hs_difference_inplace(sa, first, p);
+        wrong = 0;
+        for (k = 0; k < 40000; k++) {
+            if (hs_contains(sa, &churn[k]) != (k >= 5000 && k < 10000)) wrong++;
+        }
+        hs_stats(sa, &su_st);
+        printf("%s in place: ok %d, size %zu, wrong %d\n", p ? "Set algebra (pool)" : "Set algebra",
+               (int)(ok1 && ok2 && ok3), su_st.size, wrong);
+        hs_destroy(first);
+        hs_destroy(su);
+        hs_destroy(si);
+        hs_destroy(sd);
+        hs_destroy(sa);
+        hs_destroy(sb);
+    }
+    thread_pool_destroy(pool);
+
+    /* b larger and configured differently: results follow a, and keep a's pointers */
+    static int dup[1000];
+    HashSet* da = hs_create_ex(16, int_hash, int_eq, HS_ROBIN_HOOD, 0.5f);
+    HashSet* db = hs_create(16, int_hash, int_eq);
+    for (k = 0; k < 1000; k++) {
+        dup[k] = k;                    /* equal to churn[k], other pointer */
+        hs_insert(da, &dup[k]);
+    }
+    for (k = 0; k < 5000; k++) hs_insert(db, &churn[k]);
+    HashSet* du = hs_union(da, db, NULL);
+    HashSet* di = hs_intersect(db, da, NULL);   /* first operand larger: keeps db's pointers */
+    HSIter dit;
+    void* de;
+    wrong = 0;
+    hs_iter_init(du, &dit);
+    while (hs_iter_next(&dit, &de)) {
+        int v = *(int*)de;
+        if (de != (v < 1000 ? (void*)&dup[v] : (void*)&churn[v])) wrong++;
+    }
+    hs_iter_init(di, &dit);
+    while (hs_iter_next(&dit, &de)) {
+        if (de != (void*)&churn[*(int*)de]) wrong++;
+    }
+    HSStats dst;
+    hs_remove(du, &churn[10]);
+    hs_stats(du, &dst);
+    printf("Union with larger b: size %zu, Robin Hood (no tombstone) %d, load <= 0.5 %d; "
+           "intersection size %zu; wrong pointers %d\n",
+           dst.size, (int)(dst.tombstones == 0), (int)(dst.load_factor <= 0.5), hs_size(di), wrong);
+    hs_destroy(du);
+    hs_destroy(di);
+    hs_destroy(da);
+    hs_destroy(db);
+
+    /* 7) Early-exit, ranged and cursor iteration */
+    HashSet* is = hs_create(16, int_hash, int_eq);
+    for (k = 0; k < 1000; k++) hs_insert(is, &churn[k]);  /* sum 0..999 = 499500 */
+    SumUntil all = { 0, 1L << 40, 0 };
+    bool complete = hs_iterate_until(is, sum_until, &all);
+    SumUntil part = { 0, 1000, 0 };
+    bool stopped = !hs_iterate_until(is, sum_until, &part);
+    /* four disjoint slot ranges cover the set exactly once */
+    SumUntil ranges = { 0, 1L << 40, 0 };
+    size_t cap = hs_capacity(is), r;
+    for (r = 0; r < 4; r++) {
+        hs_iterate_range(is, cap * r / 4, cap * (r + 1) / 4, sum_until, &ranges);
+    }
+    /* cursor, removing the element just returned */
+    HSIter hit;
+    void* he;
+    long cursor_visits = 0;
+    hs_iter_init(is, &hit);
+    while (hs_iter_next(&hit, &he)) {
+        cursor_visits++;
+        if (*(int*)he % 2 == 0) hs_remove(is, he);
+    }
+    printf("hs_iterate_until: complete %d sum %ld; stopped early %d after sum >= 1000 (%d); "
+           "ranges sum %ld visits %ld; cursor visits %ld, size after removing evens %zu\n",
+           (int)complete, all.sum, (int)stopped, (int)(part.sum >= 1000 && part.visited < 1000),
+           ranges.sum, ranges.visited, cursor_visits, hs_size(is));
+    hs_destroy(is);
+
     printf("\n=== End of containers_test ===\n");
     return 0;
 }
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 /* Instead of <pthread.h>, include our adv_thread */
 #include "adv_thread.h"
 #include "queue.h"
@@ -62,6 +63,29 @@ void* consumer_thread(void* arg) {
     return NULL;
 }
 
+/*
+ * Stoppable consumer: pops until queue_pop returns NULL because
+ * the thread was asked to stop (Thread_request_stop).
+ */
+static int g_stoppable_popped = 0;
+
+void stoppable_consumer(void* arg) {
+    Queue* q = (Queue*)arg;
+    int* data;
+    while ((data = (int*)queue_pop(q)) != NULL) {
+        g_stoppable_popped++;
+        free(data);
+    }
+    printf("[Stoppable consumer] Stop requested, leaving after %d items\n", g_stoppable_popped);
+}
+
+/* Sleeps "forever" in an interruptible sleep */
+void stoppable_sleeper(void* arg) {
+    (void)arg;
+    bool slept_full = Thread_sleep_interruptible(ULLONG_MAX);
+    printf("[Stoppable sleeper] Woke up early => %d\n", (int)!slept_full);
+}
+
 int main(void) {
     Queue* q = queue_create();
     if (!q) {
@@ -116,6 +140,33 @@ int main(void) {
 
     printf("Queue size after all threads finished: %zu\n", queue_size(q));
 
+    /*
+     * 3. Cooperative stop: a consumer blocked in queue_pop and a thread in an
+     *    interruptible sleep are both woken by Thread_request_stop.
+     */
+    Thread consumer, sleeper;
+    Thread_init(&consumer, stoppable_consumer, q, "StopConsumer");
+    Thread_init(&sleeper, stoppable_sleeper, NULL, "StopSleeper");
+    Thread_start(&consumer);
+    Thread_start(&sleeper);
+
+    for (int i = 0; i < 3; i++) {
+        int* data = (int*)malloc(sizeof(int));
+        *data = i;
+        queue_push(q, data);
+    }
+    while (!queue_is_empty(q)) {
+        Thread_yield();
+    }
+    Thread_sleep_interruptible(10000000ULL); // let the consumer block on the empty queue
+
+    Thread_request_stop(&consumer);
+    Thread_request_stop(&sleeper);
+    Thread_join(&consumer);
+    Thread_join(&sleeper);
+    printf("Stop requested flags: consumer=%d, sleeper=%d\n",
+           (int)Thread_stop_requested(&consumer), (int)Thread_stop_requested(&sleeper));
+
     queue_destroy(q);
     return 0;
 }
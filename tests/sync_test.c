@@ -0,0 +1,430 @@
+/*
+ * sync_test.c
+ *
+ * Minimal test for the synchronization primitives:
+ *   - Mutex (with adaptive spin)
+ *   - RWLock (readers + writers)
+ *   - CondVar (signal + timed wait)
+ *   - Barrier (phased loop), Latch (countdown), EventCount (lock-free handoff)
+ *   - EpochDomain (lock-free readers while a writer swaps and retires nodes)
+ *   - ConcurrentHashTable (disjoint inserts + racing compute_if_absent)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "adv_thread.h"
+#include "adv_mutex.h"
+#include "adv_semaphore.h"
+#include "adv_atomic.h"
+#include "adv_epoch.h"
+#include "containers.h"
+
+#define NUM_THREADS 4
+#define ITERATIONS  100000
+#define PHASES      1000
+#define HANDOFFS    20000
+#define SWAPS       20000
+#define CHT_KEYS    5000
+#define CHT_SHARED  100
+
+/* ===================== Mutex ===================== */
+
+typedef struct {
+    Mutex mutex;
+    long  counter;
+} MutexTest;
+
+static void* mutex_worker(void* arg) {
+    MutexTest* mt = (MutexTest*)arg;
+    for (int i = 0; i < ITERATIONS; i++) {
+        Mutex_lock(&mt->mutex);
+        mt->counter++;
+        Mutex_unlock(&mt->mutex);
+    }
+    return NULL;
+}
+
+/* ===================== RWLock ===================== */
+
+/* Writers keep a == b; readers check they never see them differ. */
+typedef struct {
+    RWLock rw;
+    long   a;
+    long   b;
+    long   torn_reads;
+} RWTest;
+
+static void* rw_writer(void* arg) {
+    RWTest* rt = (RWTest*)arg;
+    for (int i = 0; i < ITERATIONS / 10; i++) {
+        RWLock_write_lock(&rt->rw);
+        rt->a++;
+        rt->b++;
+        RWLock_write_unlock(&rt->rw);
+    }
+    return NULL;
+}
+
+static void* rw_reader(void* arg) {
+    RWTest* rt = (RWTest*)arg;
+    for (int i = 0; i < ITERATIONS / 10; i++) {
+        RWLock_read_lock(&rt->rw);
+        if (rt->a != rt->b) {
+            rt->torn_reads++; /* racy on purpose: should stay 0 */
+        }
+        RWLock_read_unlock(&rt->rw);
+    }
+    return NULL;
+}
+
+/* ===================== CondVar ===================== */
+
+typedef struct {
+    Mutex   mutex;
+    CondVar cond;
+    bool    ready;
+} CondTest;
+
+static void* cond_signaler(void* arg) {
+    CondTest* ct = (CondTest*)arg;
+    Mutex_lock(&ct->mutex);
+    ct->ready = true;
+    CondVar_signal(&ct->cond);
+    Mutex_unlock(&ct->mutex);
+    return NULL;
+}
+
+/* ===================== Barrier ===================== */
+
+/* Each phase, every thread bumps its own slot; the serial thread checks they all match. */
+typedef struct {
+    Barrier barrier;
+    long    slots[NUM_THREADS];
+    int     next_id;
+    long    serial_count;
+    long    mismatches;
+} BarrierTest;
+
+static void* barrier_worker(void* arg) {
+    BarrierTest* bt = (BarrierTest*)arg;
+    int id = adv_atomic_fetch_add_int(&bt->next_id, 1, ADV_RELAXED);
+    for (long phase = 0; phase < PHASES; phase++) {
+        bt->slots[id]++;
+        if (Barrier_wait(&bt->barrier)) {
+            bt->serial_count++;
+            for (int i = 0; i < NUM_THREADS; i++) {
+                if (bt->slots[i] != phase + 1) bt->mismatches++;
+            }
+        }
+        // keep everyone out of the next phase until the check is done
+        Barrier_wait(&bt->barrier);
+    }
+    return NULL;
+}
+
+/* ===================== Latch ===================== */
+
+static void* latch_worker(void* arg) {
+    Latch_count_down((Latch*)arg, 1);
+    return NULL;
+}
+
+/* ===================== EventCount ===================== */
+
+/* 'available' is a lock-free item count; the consumer sleeps on the EventCount when it is 0. */
+typedef struct {
+    EventCount   ec;
+    volatile int available;
+    long         consumed;
+} EventTest;
+
+static bool event_try_take(EventTest* et) {
+    int c = adv_atomic_load_int(&et->available, ADV_ACQUIRE);
+    while (c > 0) {
+        if (adv_atomic_cas_int(&et->available, &c, c - 1, ADV_ACQ_REL)) return true;
+    }
+    return false;
+}
+
+static void* event_consumer(void* arg) {
+    EventTest* et = (EventTest*)arg;
+    while (et->consumed < HANDOFFS) {
+        if (event_try_take(et)) {
+            et->consumed++;
+            continue;
+        }
+        int key = EventCount_prepare_wait(&et->ec);
+        if (event_try_take(et)) {
+            EventCount_cancel_wait(&et->ec);
+            et->consumed++;
+            continue;
+        }
+        EventCount_wait(&et->ec, key);
+    }
+    return NULL;
+}
+
+/* ===================== EpochDomain ===================== */
+
+#define NODE_LIVE 0x600DF00D
+#define NODE_DEAD 0xDEADBEEF
+
+typedef struct {
+    volatile unsigned magic;
+    long              value;
+} EpochNode;
+
+typedef struct {
+    EpochDomain* domain;
+    void* volatile current;   /* EpochNode*, swapped by the writer */
+    volatile int   done;
+    long           bad_reads;
+} EpochTest;
+
+static volatile int g_nodes_freed = 0;
+
+static void epoch_node_free(void* p) {
+    EpochNode* n = (EpochNode*)p;
+    n->magic = NODE_DEAD;
+    adv_atomic_fetch_add_int(&g_nodes_freed, 1, ADV_RELAXED);
+    free(n);
+}
+
+static void* epoch_reader(void* arg) {
+    EpochTest* et = (EpochTest*)arg;
+    while (!adv_atomic_load_int(&et->done, ADV_ACQUIRE)) {
+        EpochDomain_enter(et->domain);
+        EpochNode* n = (EpochNode*)adv_atomic_load_ptr(&et->current, ADV_ACQUIRE);
+        if (n->magic != NODE_LIVE) et->bad_reads++; /* racy on purpose: should stay 0 */
+        EpochDomain_exit(et->domain);
+    }
+    return NULL;
+}
+
+static void* epoch_writer(void* arg) {
+    EpochTest* et = (EpochTest*)arg;
+    for (long i = 1; i <= SWAPS; i++) {
+        EpochNode* n = (EpochNode*)malloc(sizeof(EpochNode));
+        n->magic = NODE_LIVE;
+        n->value = i;
+        EpochNode* old = (EpochNode*)adv_atomic_exchange_ptr(&et->current, n, ADV_ACQ_REL);
+        EpochDomain_retire(et->domain, old, epoch_node_free);
+    }
+    adv_atomic_store_int(&et->done, 1, ADV_RELEASE);
+    // wait out the readers, then everything we retired is freed
+    EpochDomain_synchronize(et->domain);
+    return NULL;
+}
+
+/* ===================== ConcurrentHashTable ===================== */
+
+typedef struct {
+    ConcurrentHashTable* table;
+    volatile int         next_id;
+    volatile int         computed;   /* calls of the compute function */
+    long                 values[CHT_SHARED];
+} CHTTest;
+
+static void* cht_compute(const char* key, void* userData) {
+    CHTTest* t = (CHTTest*)userData;
+    adv_atomic_fetch_add_int(&t->computed, 1, ADV_RELAXED);
+    return &t->values[atoi(key + 7)];  /* "shared-N" */
+}
+
+static void* cht_worker(void* arg) {
+    CHTTest* t = (CHTTest*)arg;
+    int id = adv_atomic_fetch_add_int(&t->next_id, 1, ADV_RELAXED);
+    char key[32];
+    for (int i = 0; i < CHT_KEYS; i++) {
+        snprintf(key, sizeof(key), "t%d-%d", id, i);
+        cht_insert_or_assign(t->table, key, t);
+        /* every thread races for the same shared keys */
+        snprintf(key, sizeof(key), "shared-%d", i % CHT_SHARED);
+        cht_compute_if_absent(t->table, key, cht_compute, t);
+    }
+    /* then drops every other key of its own */
+    for (int i = 0; i < CHT_KEYS; i += 2) {
+        snprintf(key, sizeof(key), "t%d-%d", id, i);
+        cht_remove(t->table, key);
+    }
+    return NULL;
+}
+
+int main(void) {
+    printf("=== sync_test ===\n\n");
+    AdvThread threads[NUM_THREADS];
+
+    /* 1) Mutex: NUM_THREADS threads increment a shared counter */
+    MutexTest mt;
+    Mutex_init(&mt.mutex, MUTEX_DEFAULT_SPIN);
+    mt.counter = 0;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_create(&threads[i], mutex_worker, &mt);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(&threads[i]);
+    }
+    printf("Mutex counter = %ld (expected %ld)\n", mt.counter, (long)NUM_THREADS * ITERATIONS);
+    printf("Mutex try_lock on free mutex => %d\n", (int)Mutex_try_lock(&mt.mutex));
+    printf("Mutex try_lock on held mutex => %d\n", (int)Mutex_try_lock(&mt.mutex));
+    Mutex_unlock(&mt.mutex);
+    Mutex_destroy(&mt.mutex);
+
+    /* 2) RWLock: 1 writer + (NUM_THREADS - 1) readers */
+    RWTest rt;
+    RWLock_init(&rt.rw, MUTEX_DEFAULT_SPIN);
+    rt.a = rt.b = rt.torn_reads = 0;
+    thread_create(&threads[0], rw_writer, &rt);
+    for (int i = 1; i < NUM_THREADS; i++) {
+        thread_create(&threads[i], rw_reader, &rt);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(&threads[i]);
+    }
+    printf("RWLock a = %ld, b = %ld, torn reads = %ld\n", rt.a, rt.b, rt.torn_reads);
+
+    RWLock_read_lock(&rt.rw);
+    printf("RWLock second reader while read-locked => %d\n", (int)RWLock_try_read_lock(&rt.rw));
+    RWLock_read_unlock(&rt.rw);
+    printf("RWLock writer while read-locked => %d\n", (int)RWLock_try_write_lock(&rt.rw));
+    RWLock_read_unlock(&rt.rw);
+    printf("RWLock writer when free => %d\n", (int)RWLock_try_write_lock(&rt.rw));
+    RWLock_write_unlock(&rt.rw);
+    RWLock_destroy(&rt.rw);
+
+    /* 3) CondVar: timed wait with nobody signaling, then a real handshake */
+    CondTest ct;
+    Mutex_init(&ct.mutex, 0);
+    CondVar_init(&ct.cond);
+    ct.ready = false;
+
+    Mutex_lock(&ct.mutex);
+    bool signaled = CondVar_timed_wait(&ct.cond, &ct.mutex, 1000000ULL);
+    printf("CondVar timed_wait(1ms) without signal => %d\n", (int)signaled);
+
+    thread_create(&threads[0], cond_signaler, &ct);
+    while (!ct.ready) {
+        CondVar_wait(&ct.cond, &ct.mutex);
+    }
+    Mutex_unlock(&ct.mutex);
+    thread_join(&threads[0]);
+    printf("CondVar handshake done, ready = %d\n", (int)ct.ready);
+
+    /* a timeout too large for a deadline means "wait forever": only the signal ends it */
+    ct.ready = false;
+    Mutex_lock(&ct.mutex);
+    thread_create(&threads[0], cond_signaler, &ct);
+    bool timed_out = false;
+    while (!ct.ready) {
+        if (!CondVar_timed_wait(&ct.cond, &ct.mutex, ULLONG_MAX)) timed_out = true;
+    }
+    Mutex_unlock(&ct.mutex);
+    thread_join(&threads[0]);
+    printf("CondVar timed_wait(ULLONG_MAX) woken by signal => %d, timed out %d\n",
+           (int)ct.ready, (int)timed_out);
+
+    CondVar_destroy(&ct.cond);
+    Mutex_destroy(&ct.mutex);
+
+    /* 4) Barrier: NUM_THREADS threads step through PHASES phases together */
+    BarrierTest bt;
+    Barrier_init(&bt.barrier, NUM_THREADS, BARRIER_DEFAULT_SPIN);
+    for (int i = 0; i < NUM_THREADS; i++) bt.slots[i] = 0;
+    bt.next_id = 0;
+    bt.serial_count = bt.mismatches = 0;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_create(&threads[i], barrier_worker, &bt);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(&threads[i]);
+    }
+    printf("Barrier phases = %d, serial returns = %ld (expected %ld), mismatches = %ld\n",
+           PHASES, bt.serial_count, (long)PHASES, bt.mismatches);
+    Barrier_destroy(&bt.barrier);
+
+    /* 5) Latch: wait for NUM_THREADS workers to count down */
+    Latch latch;
+    Latch_init(&latch, NUM_THREADS);
+    bool early = Latch_timed_wait(&latch, 1000000ULL);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_create(&threads[i], latch_worker, &latch);
+    }
+    Latch_wait(&latch);
+    bool open_now = Latch_try_wait(&latch);
+    printf("Latch timed_wait(1ms) before count_down => %d, open after workers => %d\n",
+           (int)early, (int)open_now);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(&threads[i]);
+    }
+    Latch_destroy(&latch);
+
+    /* 6) EventCount: one producer hands HANDOFFS items to a sleeping consumer */
+    EventTest et;
+    EventCount_init(&et.ec);
+    et.available = 0;
+    et.consumed = 0;
+    int key = EventCount_prepare_wait(&et.ec);
+    bool notified = EventCount_timed_wait(&et.ec, key, 1000000ULL);
+    thread_create(&threads[0], event_consumer, &et);
+    for (int i = 0; i < HANDOFFS; i++) {
+        adv_atomic_fetch_add_int(&et.available, 1, ADV_RELEASE);
+        EventCount_notify_one(&et.ec);
+    }
+    thread_join(&threads[0]);
+    printf("EventCount timed_wait(1ms) without notify => %d, consumed = %ld (expected %d)\n",
+           (int)notified, et.consumed, HANDOFFS);
+    EventCount_destroy(&et.ec);
+
+    /* 7) EpochDomain: 1 writer swaps + retires nodes under (NUM_THREADS - 1) lock-free readers */
+    EpochTest ept;
+    ept.domain = EpochDomain_create(0);
+    EpochNode* first = (EpochNode*)malloc(sizeof(EpochNode));
+    first->magic = NODE_LIVE;
+    first->value = 0;
+    ept.current = first;
+    ept.done = 0;
+    ept.bad_reads = 0;
+    thread_create(&threads[0], epoch_writer, &ept);
+    for (int i = 1; i < NUM_THREADS; i++) {
+        thread_create(&threads[i], epoch_reader, &ept);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(&threads[i]);
+    }
+    printf("EpochDomain bad reads = %ld, freed after synchronize = %d (expected %d)\n",
+           ept.bad_reads, adv_atomic_load_int(&g_nodes_freed, ADV_RELAXED), SWAPS);
+    EpochDomain_destroy(ept.domain);
+    free((void*)ept.current);
+
+    /* 8) ConcurrentHashTable: NUM_THREADS threads insert, compute and remove concurrently */
+    CHTTest cht;
+    cht.table = cht_create(16, 8);
+    cht.next_id = 0;
+    cht.computed = 0;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_create(&threads[i], cht_worker, &cht);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(&threads[i]);
+    }
+    long cht_wrong = 0;
+    char ckey[32];
+    for (int id = 0; id < NUM_THREADS; id++) {
+        for (int i = 0; i < CHT_KEYS; i++) {
+            snprintf(ckey, sizeof(ckey), "t%d-%d", id, i);
+            if ((i % 2 == 1) != (cht_get(cht.table, ckey) == &cht)) cht_wrong++;
+        }
+    }
+    for (int i = 0; i < CHT_SHARED; i++) {
+        snprintf(ckey, sizeof(ckey), "shared-%d", i);
+        if (cht_get(cht.table, ckey) != &cht.values[i]) cht_wrong++;
+    }
+    printf("ConcurrentHashTable size = %zu (expected %d), computed = %d (expected %d), wrong = %ld\n",
+           cht_size(cht.table), NUM_THREADS * CHT_KEYS / 2 + CHT_SHARED,
+           cht.computed, CHT_SHARED, cht_wrong);
+    cht_destroy(cht.table);
+
+    printf("\n=== End of sync_test ===\n");
+    return 0;
+}
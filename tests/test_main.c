@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include "adv_thread.h"
 #include "adv_semaphore.h"
+#include "adv_atomic.h"
 #include "queue.h"
 
 /* Simple function for the thread target */
@@ -19,6 +20,41 @@ static void my_thread_func(void* arg) {
     printf("[my_thread_func] running with message: %s\n", msg);
 }
 
+/* Thread-local storage + sharded counter */
+static ThreadLocal     g_tls;
+static ShardedCounter* g_counter;
+static volatile int    g_tls_released = 0;
+
+static void tls_release(void* value) {
+    free(value);
+    adv_atomic_fetch_add_int(&g_tls_released, 1, ADV_SEQ_CST);
+}
+
+static void* tls_worker(void* arg) {
+    (void)arg;
+    int* mine = (int*)malloc(sizeof(int));
+    *mine = 0;
+    ThreadLocal_set(&g_tls, mine);
+    for (int i = 0; i < 1000; i++) {
+        (*(int*)ThreadLocal_get(&g_tls))++;
+        ShardedCounter_add(g_counter, 1);
+    }
+    return NULL;
+}
+
+/* Waits on the semaphore passed as arg */
+static void sem_waiter_func(void* arg) {
+    Semaphore* s = (Semaphore*)arg;
+    Semaphore_wait(s);
+}
+
+/* Returns a heap-allocated square of *arg, picked up with thread_join_result */
+void* square_func(void* arg) {
+    long* out = (long*)malloc(sizeof(long));
+    if (out) *out = (*(long*)arg) * (*(long*)arg);
+    return out;
+}
+
 int main(void) {
     printf("=== test_main ===\n");
 
@@ -36,8 +72,77 @@ int main(void) {
     Thread_join(&t);  // if we didn't kill, it will just join after run finishes
     printf("Thread is alive after join? %d\n", (int)Thread_is_alive(&t));
 
-    /* Test adv_semaphore: 2 threads wait on a semaphore? 
-       We'll skip for brevity, but usage is straightforward. */
+    /* thread_create keeps the start_routine's return value */
+    AdvThread squarer;
+    long side = 12;
+    void* area = NULL;
+    thread_create(&squarer, square_func, &side);
+    thread_join_result(&squarer, &area);
+    printf("thread_join_result => %ld (expected 144)\n", area ? *(long*)area : -1L);
+    free(area);
+
+    /* Test OS-level attributes: pin to CPU 0 and lower the priority (nice 5) before start */
+    Thread pinned;
+    int cpus[] = {0};
+    Thread_init(&pinned, my_thread_func, "Hello from a pinned thread!", "PinnedWorker");
+    printf("Thread_set_affinity(cpu 0) => %d\n", (int)Thread_set_affinity(&pinned, cpus, 1));
+    printf("Thread_set_sched_policy(OTHER, nice 5) => %d\n",
+           (int)Thread_set_sched_policy(&pinned, THREAD_SCHED_OTHER, 5));
+    Thread_start(&pinned);
+    Thread_join(&pinned);
+
+    /* Test adv_semaphore: try/timed wait, then release 3 waiting threads with one post_n */
+    Semaphore sem;
+    Semaphore_init(&sem, 0, 16);
+    printf("Semaphore try_wait on 0 => %d\n", (int)Semaphore_try_wait(&sem));
+    printf("Semaphore timed_wait(1ms) on 0 => %d\n", (int)Semaphore_timed_wait(&sem, 1000000ULL));
+
+    Thread waiters[3];
+    for (int i = 0; i < 3; i++) {
+        Thread_init(&waiters[i], sem_waiter_func, &sem, "SemWaiter");
+        Thread_start(&waiters[i]);
+    }
+    Semaphore_post_n(&sem, 3);
+    for (int i = 0; i < 3; i++) {
+        Thread_join(&waiters[i]);
+    }
+    printf("3 waiters released by Semaphore_post_n(3)\n");
+
+    Semaphore_post_n(&sem, 2);
+    bool got1 = Semaphore_try_wait(&sem);
+    bool got2 = Semaphore_timed_wait(&sem, 1000000ULL);
+    bool got3 = Semaphore_try_wait(&sem);
+    printf("After post_n(2): try_wait => %d, timed_wait => %d, try_wait => %d\n",
+           (int)got1, (int)got2, (int)got3);
+    Semaphore_destroy(&sem);
+
+    /* FastSemaphore: same contract, user-space fast path */
+    FastSemaphore fsem;
+    FastSemaphore_init(&fsem, 1, 0);
+    bool fgot1 = FastSemaphore_try_wait(&fsem);
+    bool fgot2 = FastSemaphore_timed_wait(&fsem, 1000000ULL);
+    FastSemaphore_post_n(&fsem, 2);
+    bool fgot3 = FastSemaphore_try_wait(&fsem);
+    printf("FastSemaphore: try_wait => %d, timed_wait on 0 => %d, try_wait after post_n(2) => %d\n",
+           (int)fgot1, (int)fgot2, (int)fgot3);
+    FastSemaphore_destroy(&fsem);
+
+    /* Test ThreadLocal (destructor at exit) and ShardedCounter (aggregated on read) */
+    ThreadLocal_init(&g_tls, tls_release);
+    g_counter = ShardedCounter_create();
+    AdvThread tls_threads[4];
+    for (int i = 0; i < 4; i++) {
+        thread_create(&tls_threads[i], tls_worker, NULL);
+    }
+    for (int i = 0; i < 4; i++) {
+        thread_join(&tls_threads[i]);
+    }
+    ShardedCounter_add(g_counter, 5);
+    printf("ShardedCounter = %lld (expected 4005), TLS destructors run = %d\n",
+           ShardedCounter_read(g_counter), g_tls_released);
+    printf("ThreadLocal in main thread (never set) => %p\n", ThreadLocal_get(&g_tls));
+    ShardedCounter_destroy(g_counter);
+    ThreadLocal_destroy(&g_tls);
 
     /* Test queue */
     Queue* q = queue_create();